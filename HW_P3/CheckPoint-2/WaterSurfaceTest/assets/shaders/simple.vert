@@ -4,11 +4,14 @@ layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 texture_coordinate;
 
 uniform mat4 u_model;
+uniform mat3 u_normal_matrix;   // transpose(inverse(u_model)), computed once on the CPU
 
 layout (std140, binding = 0) uniform commom_matrices
 {
     mat4 u_projection;
     mat4 u_view;
+    vec3 u_view_pos;
+    float u_time;
 };
 
 out V_OUT
@@ -23,6 +26,6 @@ void main()
     gl_Position = u_projection * u_view * u_model * vec4(position, 1.0f);
 
     v_out.position = vec3(u_model * vec4(position, 1.0f));
-    v_out.normal = mat3(transpose(inverse(u_model))) * normal;
+    v_out.normal = u_normal_matrix * normal;
     v_out.texture_coordinate = vec2(texture_coordinate.x, 1.0f - texture_coordinate.y);
 }
\ No newline at end of file
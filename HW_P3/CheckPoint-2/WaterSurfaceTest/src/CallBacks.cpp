@@ -254,11 +254,12 @@ void keeping_water(TrainWindow* tw)
 		lastRedraw = clock();
 		tw->time += 0.01f;
 		tw->height_map_index += tw->wavespeed->value();
+		tw->ocean_time += tw->wavespeed->value() / 30.0f;
 		tw->damageMe();
 		if (std::numeric_limits<float>::max() - tw->time <= 0.01f) {
 			tw->time = 0.0f;
 		}
-		if (tw->height_map_index >= 200.0f) {
+		if (tw->height_map_index >= tw->height_map_frames) {
 			tw->height_map_index = 0.0f;
 		}
 	}
@@ -0,0 +1,95 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "Utilities/ArcBallCam.H"
+
+// the view and projection of the current frame, kept on the CPU.
+// shaders, picking and culling read them from here instead of reading the fixed-function stacks back with glGetFloatv,
+// which can make the driver wait for the GPU. load() pushes them to the stacks for what is still drawn the old way
+class Camera
+{
+public:
+	glm::mat4 view = glm::mat4(1.0f);
+	glm::mat4 projection = glm::mat4(1.0f);
+	glm::vec3 position = glm::vec3(0.0f);
+
+	// the same matrices ArcBallCam::setProjection builds on the stacks
+	void arcball(const ArcBallCam& ball, float aspect, float z_near, float z_far)
+	{
+		HMatrix rotation;
+		ball.getMatrix(rotation);
+		float x, y, z;
+		ball.getEye(x, y, z);
+		projection = glm::perspective(glm::radians(ball.getFoV()), aspect, z_near, z_far);
+		set_view(glm::translate(glm::mat4(1.0f), glm::vec3(-x, -y, -z)) * glm::make_mat4((float*)rotation));
+	}
+
+	void set_view(const glm::mat4& _view)
+	{
+		view = _view;
+		position = glm::vec3(glm::inverse(view)[3]);
+	}
+
+	glm::mat4 view_projection() const { return projection * view; }
+
+	// how much of the screen height a sphere covers, 1 when it fills it. for picking levels of detail
+	float screen_size(const glm::vec3& center, float radius) const
+	{
+		// orthographic projections don't shrink with distance
+		if (projection[2][3] == 0.0f)
+			return radius * projection[1][1];
+		float distance = glm::length(center - position);
+		if (distance <= radius)
+			return 1.0f;
+		return radius * projection[1][1] / distance;
+	}
+
+	// multiplies the projection onto what is already there (a pick matrix for example) and loads the view
+	void load() const
+	{
+		glMatrixMode(GL_PROJECTION);
+		glMultMatrixf(glm::value_ptr(projection));
+		glMatrixMode(GL_MODELVIEW);
+		glLoadMatrixf(glm::value_ptr(view));
+	}
+
+	// the points under window pixel (x, y) on the near and far planes, y going down like FlTk's
+	void ray(float x, float y, int w, int h, glm::vec3& from, glm::vec3& to) const
+	{
+		glm::vec4 viewport(0, 0, w, h);
+		from = glm::unProject(glm::vec3(x, h - y, 0.0f), view, projection, viewport);
+		to = glm::unProject(glm::vec3(x, h - y, 1.0f), view, projection, viewport);
+	}
+
+	// Gribb/Hartmann planes in world space, a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all six
+	void frustum(glm::vec4 planes[6]) const
+	{
+		glm::mat4 m = view_projection();
+		glm::vec4 row[4];
+		for (int i = 0; i < 4; i++)
+			row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+		planes[0] = row[3] + row[0];
+		planes[1] = row[3] - row[0];
+		planes[2] = row[3] + row[1];
+		planes[3] = row[3] - row[1];
+		planes[4] = row[3] + row[2];
+		planes[5] = row[3] - row[2];
+	}
+
+	// false when the box is entirely behind one of the frustum's planes
+	static bool visible(const glm::vec4 planes[6], const glm::vec3& low, const glm::vec3& high)
+	{
+		for (int i = 0; i < 6; i++) {
+			glm::vec3 far_corner(planes[i].x > 0 ? high.x : low.x, planes[i].y > 0 ? high.y : low.y, planes[i].z > 0 ? high.z : low.z);
+			if (glm::dot(glm::vec3(planes[i]), far_corner) + planes[i].w < 0)
+				return false;
+		}
+		return true;
+	}
+};
+#endif
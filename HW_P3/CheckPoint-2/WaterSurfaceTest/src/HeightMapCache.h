@@ -0,0 +1,218 @@
+#ifndef HEIGHT_MAP_CACHE_H
+#define HEIGHT_MAP_CACHE_H
+
+#include <glad/glad.h>
+
+#include "stb_image.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <list>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <iostream>
+
+// streams the height map frames through a bounded set of GPU textures.
+// PNG decoding happens on a worker thread, uploads happen on the GL thread in update(),
+// and the least recently used frames are deleted once the byte budget is exceeded.
+class HeightMapCache
+{
+public:
+    HeightMapCache() {}
+    HeightMapCache(const HeightMapCache&) = delete;
+    HeightMapCache& operator=(const HeightMapCache&) = delete;
+    ~HeightMapCache()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        wake.notify_all();
+        if (worker.joinable())
+            worker.join();
+        for (auto& d : decoded)
+            stbi_image_free(d.data);
+    }
+
+    // budget in bytes of texture memory, window is how many frames ahead of the current one we keep resident
+    void configure(size_t _budget, int _window)
+    {
+        budget = _budget;
+        window = _window;
+    }
+
+    void add_frame(const std::string& path)
+    {
+        frames.push_back(Frame());
+        frames.back().path = path;
+    }
+
+    int size() const { return (int)frames.size(); }
+    size_t resident_bytes() const { return used; }
+
+    // call once per frame on the GL thread before drawing
+    void update(int current)
+    {
+        if (frames.empty())
+            return;
+        if (!worker.joinable())
+            worker = std::thread(&HeightMapCache::decode_loop, this);
+
+        // upload whatever the worker finished since last frame
+        std::vector<Decoded> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.swap(decoded);
+        }
+        for (auto& d : ready) {
+            if (!frames[d.index].id && d.data)
+                upload(d.index, d.data, d.width, d.height);
+            stbi_image_free(d.data);
+        }
+
+        // queue the sliding window ahead of the current frame, nearest first
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            requests.clear();
+            for (int i = 0; i <= window; i++) {
+                int index = wrap(current + i);
+                if (!frames[index].id && std::find(in_flight.begin(), in_flight.end(), index) == in_flight.end())
+                    requests.push_back(index);
+            }
+        }
+        wake.notify_one();
+
+        evict(current);
+    }
+
+    // texture of the given frame, falls back to the last bound frame while the requested one is in flight
+    unsigned int get(int index)
+    {
+        if (frames.empty())
+            return 0;
+        index = wrap(index);
+        Frame& f = frames[index];
+        if (!f.id) {
+            if (last_id)
+                return last_id;
+            // nothing resident yet (first frame), load it synchronously
+            int width, height, nrComponents;
+            unsigned char* data = stbi_load(f.path.c_str(), &width, &height, &nrComponents, STBI_rgb_alpha);
+            if (!data) {
+                std::cout << "Texture failed to load at path: " << f.path << std::endl;
+                return 0;
+            }
+            upload(index, data, width, height);
+            stbi_image_free(data);
+        }
+        lru.splice(lru.begin(), lru, f.lru_it);
+        last_id = f.id;
+        return f.id;
+    }
+
+private:
+    struct Frame {
+        std::string path;
+        unsigned int id = 0;
+        size_t bytes = 0;
+        std::list<int>::iterator lru_it;
+    };
+    struct Decoded {
+        int index;
+        int width, height;
+        unsigned char* data;
+    };
+
+    int wrap(int index) const
+    {
+        int n = (int)frames.size();
+        return ((index % n) + n) % n;
+    }
+
+    void upload(int index, unsigned char* data, int width, int height)
+    {
+        Frame& f = frames[index];
+        glGenTextures(1, &f.id);
+        glBindTexture(GL_TEXTURE_2D, f.id);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        // RGBA8 plus the mip chain is about 4/3 of the base level
+        f.bytes = (size_t)width * height * 4 * 4 / 3;
+        used += f.bytes;
+        lru.push_front(index);
+        f.lru_it = lru.begin();
+    }
+
+    // drop least recently used frames until we are under budget, never the ones inside the window
+    void evict(int current)
+    {
+        auto it = lru.end();
+        while (used > budget && it != lru.begin()) {
+            --it;
+            int index = *it;
+            int ahead = wrap(index - current);
+            if (ahead <= window || frames[index].id == last_id)
+                continue;
+            Frame& f = frames[index];
+            glDeleteTextures(1, &f.id);
+            f.id = 0;
+            used -= f.bytes;
+            f.bytes = 0;
+            it = lru.erase(it);
+        }
+    }
+
+    void decode_loop()
+    {
+        for (;;) {
+            int index;
+            std::string path;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stop || !requests.empty(); });
+                if (stop)
+                    return;
+                index = requests.front();
+                requests.pop_front();
+                in_flight.push_back(index);
+                path = frames[index].path;
+            }
+            Decoded d;
+            d.index = index;
+            int nrComponents;
+            d.data = stbi_load(path.c_str(), &d.width, &d.height, &nrComponents, STBI_rgb_alpha);
+            if (!d.data)
+                std::cout << "Texture failed to load at path: " << path << std::endl;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                in_flight.erase(std::find(in_flight.begin(), in_flight.end(), index));
+                decoded.push_back(d);
+            }
+        }
+    }
+
+    std::vector<Frame> frames;
+    std::list<int> lru;
+    size_t budget = 64 << 20;
+    size_t used = 0;
+    int window = 16;
+    unsigned int last_id = 0;
+
+    // shared with the worker
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<int> requests;
+    std::vector<int> in_flight;
+    std::vector<Decoded> decoded;
+    bool stop = false;
+};
+#endif
@@ -0,0 +1,495 @@
+#ifndef HEIGHT_SEQUENCE_H
+#define HEIGHT_SEQUENCE_H
+
+#include <glad/glad.h>
+
+#include "stb_image.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <queue>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <utility>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <iostream>
+
+// packed height map animation (.hseq)
+//
+//  header  : "HSEQ", version, width, height, frame count, keyframe interval, quantization step
+//  table   : frame count x { offset, size } into the payload
+//  payload : one chunk per frame. Heights are stored in units of the quantization step,
+//            keyframes are predicted from their own neighbours (left/up/up-left),
+//            the other frames from the previous frame plus the change of the texel to the left.
+//            the zigzagged residuals are huffman coded, the chunk starts with the 256 code lengths.
+//            residuals from 255 up are an escape code followed by the value in ESCAPE_BITS bits.
+//
+// heights are 16 bit. The decoder runs on a worker thread and the GL thread keeps
+// the two frames around the fractional index on the GPU so the shader can blend them.
+class HeightSequence
+{
+public:
+    HeightSequence() {}
+    HeightSequence(const HeightSequence&) = delete;
+    HeightSequence& operator=(const HeightSequence&) = delete;
+    ~HeightSequence()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        wake.notify_all();
+        if (worker.joinable())
+            worker.join();
+    }
+
+    // one frame handed to pack(), heights widened to 16 bit
+    struct Frame
+    {
+        int width = 0, height = 0;
+        bool is16 = true;           // false for 8 bit sources, widened by 257
+        std::vector<uint16_t> heights;
+    };
+
+    // offline: packs a list of 8 or 16 bit height map images, every keyframe_interval-th frame is a keyframe.
+    // bits > 0 quantizes the heights to that many bits, 0 keeps the source precision (lossless)
+    static bool pack(const std::vector<std::string>& images, const std::string& out_path, int keyframe_interval = 25, int bits = 0)
+    {
+        return pack(images.size(), [&images](size_t f, Frame& frame) {
+            int nrComponents;
+            frame.is16 = stbi_is_16_bit(images[f].c_str()) != 0;
+            unsigned short* data = stbi_load_16(images[f].c_str(), &frame.width, &frame.height, &nrComponents, 1);
+            if (!data) {
+                std::cout << "ERROR::HSEQ::FAILED_TO_LOAD " << images[f] << std::endl;
+                return false;
+            }
+            frame.heights.assign(data, data + (size_t)frame.width * frame.height);
+            stbi_image_free(data);
+            return true;
+        }, out_path, keyframe_interval, bits);
+    }
+
+    // the same for frames that don't come from files, source fills frame f or returns false to give up
+    static bool pack(size_t frame_count, const std::function<bool(size_t, Frame&)>& source, const std::string& out_path,
+        int keyframe_interval = 25, int bits = 0)
+    {
+        if (frame_count == 0)
+            return false;
+        if (keyframe_interval < 1) {
+            std::cout << "ERROR::HSEQ::BAD_KEYFRAME_INTERVAL " << keyframe_interval << std::endl;
+            return false;
+        }
+        int width = 0, height = 0;
+        uint32_t step = 1;
+        std::vector<uint16_t> prev, cur;
+        std::vector<std::vector<unsigned char>> chunks;
+        Frame frame;
+        for (size_t f = 0; f < frame_count; f++) {
+            if (!source(f, frame))
+                return false;
+            if (f == 0) {
+                width = frame.width;
+                height = frame.height;
+                if (width < 1 || height < 1) {
+                    std::cout << "ERROR::HSEQ::EMPTY_FRAME " << f << std::endl;
+                    return false;
+                }
+                // 8 bit sources are widened by 257, so every height is an exact multiple of it
+                step = bits > 0 && bits < 16 ? 65535 / ((1 << bits) - 1) : (frame.is16 ? 1 : 257);
+            }
+            else if (frame.width != width || frame.height != height) {
+                std::cout << "ERROR::HSEQ::SIZE_MISMATCH " << f << std::endl;
+                return false;
+            }
+            cur.resize((size_t)width * height);
+            for (size_t i = 0; i < cur.size(); i++)
+                cur[i] = (uint16_t)(std::min)((frame.heights[i] + step / 2) / step, 65535 / step);
+
+            bool key = f % keyframe_interval == 0;
+            std::vector<uint32_t> symbols(cur.size());
+            for (size_t i = 0; i < cur.size(); i++) {
+                int r = (int)cur[i] - predict(cur, prev, i, width, key);
+                symbols[i] = (uint32_t)((r << 1) ^ (r >> 31));
+            }
+            chunks.push_back(encode(symbols));
+            prev.swap(cur);
+        }
+
+        std::ofstream out(out_path, std::ios::binary);
+        if (!out) {
+            std::cout << "ERROR::HSEQ::FAILED_TO_WRITE " << out_path << std::endl;
+            return false;
+        }
+        uint32_t header[7] = { MAGIC, VERSION, (uint32_t)width, (uint32_t)height, (uint32_t)chunks.size(), (uint32_t)keyframe_interval, step };
+        out.write((const char*)header, sizeof(header));
+        uint64_t offset = 0;
+        for (auto& c : chunks) {
+            uint64_t entry[2] = { offset, c.size() };
+            out.write((const char*)entry, sizeof(entry));
+            offset += c.size();
+        }
+        for (auto& c : chunks)
+            out.write((const char*)c.data(), c.size());
+        return true;
+    }
+
+    // runtime: loads the packed file, the chunks stay compressed in memory until decoded
+    bool open(const std::string& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            return false;
+        uint32_t header[7];
+        in.read((char*)header, sizeof(header));
+        if (!in || header[0] != MAGIC || header[1] != VERSION) {
+            std::cout << "ERROR::HSEQ::BAD_HEADER " << path << std::endl;
+            return false;
+        }
+        width = header[2];
+        height = header[3];
+        frame_count = header[4];
+        keyframe_interval = header[5];
+        step = header[6];
+        if (width < 1 || height < 1 || frame_count < 1 || keyframe_interval < 1 || step < 1) {
+            std::cout << "ERROR::HSEQ::BAD_HEADER " << path << std::endl;
+            frame_count = 0;
+            return false;
+        }
+        table.resize(frame_count * 2);
+        in.read((char*)table.data(), table.size() * sizeof(uint64_t));
+        payload.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        if (!in || payload.size() < table[(frame_count - 1) * 2] + table[(frame_count - 1) * 2 + 1]) {
+            std::cout << "ERROR::HSEQ::TRUNCATED " << path << std::endl;
+            frame_count = 0;
+            return false;
+        }
+        worker = std::thread(&HeightSequence::decode_loop, this);
+        return true;
+    }
+
+    bool is_open() const { return frame_count > 0; }
+    int size() const { return frame_count; }
+
+    // decodes frame f on the calling thread, starting from its keyframe. for tools, the renderer goes through update()
+    bool read(int f, std::vector<uint16_t>& heights) const
+    {
+        if (f < 0 || f >= frame_count)
+            return false;
+        std::vector<uint16_t> state, scratch;
+        int at = f - f % keyframe_interval;
+        decode(at, state, scratch);
+        while (at < f) {
+            decode(++at, scratch, state);
+            state.swap(scratch);
+        }
+        heights.resize(state.size());
+        for (size_t i = 0; i < state.size(); i++)
+            heights[i] = (uint16_t)(state[i] * step);
+        return true;
+    }
+
+    // call once per frame on the GL thread, keeps floor(index) and the frame after it resident.
+    // returns the blend factor between current() and next()
+    float update(float index)
+    {
+        int a = wrap((int)index);
+        int b = wrap(a + 1);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            want = a;
+        }
+        wake.notify_one();
+
+        if (!slot_tex[0]) {
+            glGenTextures(2, slot_tex);
+            for (int i = 0; i < 2; i++) {
+                glBindTexture(GL_TEXTURE_2D, slot_tex[i]);
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_R16, width, height, 0, GL_RED, GL_UNSIGNED_SHORT, NULL);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            }
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+
+        // the frame we need for "next" is often the one we already hold as "current" after a step
+        if (slot_frame[1] == a && slot_frame[0] != a) {
+            std::swap(slot_tex[0], slot_tex[1]);
+            std::swap(slot_frame[0], slot_frame[1]);
+        }
+        // block only before the very first frame, afterwards keep the old frames until the worker catches up
+        fill(0, a, slot_frame[0] < 0);
+        fill(1, b, slot_frame[1] < 0);
+
+        if (slot_frame[0] != a || slot_frame[1] != b)
+            return 0.0f;
+        return index - (float)(int)index;
+    }
+
+    unsigned int current() const { return slot_tex[0]; }
+    unsigned int next() const { return slot_tex[1]; }
+
+private:
+    static const uint32_t MAGIC = 0x51455348; // "HSEQ"
+    static const uint32_t VERSION = 2;        // 2 widened the escapes from 17 bits
+    static const int AHEAD = 4;
+
+    static const uint32_t ESCAPE = 255;
+    // a residual against the previous frame is within +-2 * 65535, zigzagged that is below 2^18
+    static const int ESCAPE_BITS = 18;
+    static const int MAX_CODE_LENGTH = 15;
+
+    static int predict(const std::vector<uint16_t>& cur, const std::vector<uint16_t>& prev, size_t i, int width, bool key)
+    {
+        size_t x = i % width;
+        if (!key)
+            return x ? prev[i] + cur[i - 1] - prev[i - 1] : prev[i];
+        if (i < (size_t)width)
+            return x ? cur[i - 1] : 0;
+        if (!x)
+            return cur[i - width];
+        // median edge detector, as in LOCO-I
+        int l = cur[i - 1], u = cur[i - width], ul = cur[i - width - 1];
+        if (ul >= (std::max)(l, u))
+            return (std::min)(l, u);
+        if (ul <= (std::min)(l, u))
+            return (std::max)(l, u);
+        return l + u - ul;
+    }
+
+    // huffman code lengths for the 256 symbols, limited to MAX_CODE_LENGTH by flattening the histogram
+    static void code_lengths(std::vector<uint32_t> freq, unsigned char* length)
+    {
+        for (;;) {
+            std::vector<int> parent(512, -1);
+            std::priority_queue<std::pair<uint64_t, int>, std::vector<std::pair<uint64_t, int>>, std::greater<std::pair<uint64_t, int>>> queue;
+            for (int i = 0; i < 256; i++)
+                if (freq[i])
+                    queue.push(std::make_pair((uint64_t)freq[i], i));
+            int next = 256;
+            while (queue.size() > 1) {
+                auto a = queue.top(); queue.pop();
+                auto b = queue.top(); queue.pop();
+                parent[a.second] = parent[b.second] = next;
+                queue.push(std::make_pair(a.first + b.first, next++));
+            }
+            int longest = 0;
+            for (int i = 0; i < 256; i++) {
+                int depth = 0;
+                if (freq[i])
+                    for (int n = i; parent[n] >= 0; n = parent[n])
+                        depth++;
+                // a lone symbol still needs one bit
+                length[i] = (unsigned char)(freq[i] ? (std::max)(depth, 1) : 0);
+                longest = (std::max)(longest, depth);
+            }
+            if (longest <= MAX_CODE_LENGTH)
+                return;
+            for (auto& c : freq)
+                if (c)
+                    c = (c + 1) / 2;
+        }
+    }
+
+    // canonical codes, shorter codes first and ties broken by symbol
+    static void canonical_codes(const unsigned char* length, uint32_t* code)
+    {
+        uint32_t c = 0;
+        for (int len = 1; len <= MAX_CODE_LENGTH; len++) {
+            for (int i = 0; i < 256; i++)
+                if (length[i] == len)
+                    code[i] = c++;
+            c <<= 1;
+        }
+    }
+
+    static std::vector<unsigned char> encode(const std::vector<uint32_t>& symbols)
+    {
+        std::vector<uint32_t> freq(256, 0);
+        for (uint32_t s : symbols)
+            freq[(std::min)(s, ESCAPE)]++;
+        std::vector<unsigned char> out(256);
+        code_lengths(freq, out.data());
+        uint32_t code[256];
+        canonical_codes(out.data(), code);
+
+        uint32_t bits = 0;
+        int count = 0;
+        auto put = [&](uint32_t v, int n) {
+            for (int b = n - 1; b >= 0; b--) {
+                bits = (bits << 1) | ((v >> b) & 1);
+                if (++count == 8) {
+                    out.push_back((unsigned char)bits);
+                    bits = 0;
+                    count = 0;
+                }
+            }
+        };
+        for (uint32_t s : symbols) {
+            uint32_t sym = (std::min)(s, ESCAPE);
+            put(code[sym], out[sym]);
+            if (sym == ESCAPE)
+                put(s, ESCAPE_BITS);
+        }
+        if (count)
+            out.push_back((unsigned char)(bits << (8 - count)));
+        return out;
+    }
+
+    int wrap(int index) const
+    {
+        return ((index % frame_count) + frame_count) % frame_count;
+    }
+
+    // decodes chunk f into cur, prev must hold frame f - 1 unless f is a keyframe
+    void decode(int f, std::vector<uint16_t>& cur, const std::vector<uint16_t>& prev) const
+    {
+        bool key = f % keyframe_interval == 0;
+        const unsigned char* length = payload.data() + table[f * 2];
+        const unsigned char* p = length + 256;
+
+        // canonical decoding tables: how many codes of each length, and the symbols in code order
+        int count[MAX_CODE_LENGTH + 1] = { 0 };
+        std::vector<int> sorted;
+        for (int len = 1; len <= MAX_CODE_LENGTH; len++)
+            for (int i = 0; i < 256; i++)
+                if (length[i] == len) {
+                    count[len]++;
+                    sorted.push_back(i);
+                }
+
+        int bit = 8;
+        unsigned char byte = 0;
+        auto get = [&]() -> uint32_t {
+            if (bit == 8) {
+                byte = *p++;
+                bit = 0;
+            }
+            return (byte >> (7 - bit++)) & 1;
+        };
+
+        size_t n = (size_t)width * height;
+        cur.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            int code = 0, first = 0, index = 0;
+            uint32_t sym = 0;
+            for (int len = 1; len <= MAX_CODE_LENGTH; len++) {
+                code |= get();
+                if (code - first < count[len]) {
+                    sym = sorted[index + code - first];
+                    break;
+                }
+                index += count[len];
+                first = (first + count[len]) << 1;
+                code <<= 1;
+            }
+            if (sym == ESCAPE) {
+                sym = 0;
+                for (int b = 0; b < ESCAPE_BITS; b++)
+                    sym = (sym << 1) | get();
+            }
+            int r = (int)(sym >> 1) ^ -(int)(sym & 1);
+            cur[i] = (uint16_t)(predict(cur, prev, i, width, key) + r);
+        }
+    }
+
+    // uploads frame f into slot, waiting for the worker only if asked to
+    void fill(int slot, int f, bool wait)
+    {
+        if (slot_frame[slot] == f)
+            return;
+        std::vector<uint16_t> data;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (wait)
+                ready_cv.wait(lock, [this, f] { return ready.count(f) > 0; });
+            auto it = ready.find(f);
+            if (it == ready.end())
+                return;
+            data = it->second;
+        }
+        glBindTexture(GL_TEXTURE_2D, slot_tex[slot]);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RED, GL_UNSIGNED_SHORT, data.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        slot_frame[slot] = f;
+    }
+
+    // decodes want .. want + AHEAD in order, restarting from the nearest keyframe when it jumps backwards
+    void decode_loop()
+    {
+        std::vector<uint16_t> state, scratch;
+        int at = -1;
+        for (;;) {
+            int f = -1;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this, &f] {
+                    if (stop)
+                        return true;
+                    // forget frames behind the playhead
+                    for (auto it = ready.begin(); it != ready.end();) {
+                        if (wrap(it->first - want) > AHEAD)
+                            it = ready.erase(it);
+                        else
+                            ++it;
+                    }
+                    for (int i = 0; i <= AHEAD; i++) {
+                        if (!ready.count(wrap(want + i))) {
+                            f = wrap(want + i);
+                            return true;
+                        }
+                    }
+                    return false;
+                });
+                if (stop)
+                    return;
+            }
+            int key = f - f % keyframe_interval;
+            if (at < key || at > f) {
+                at = key;
+                decode(at, state, scratch);
+            }
+            while (at < f) {
+                decode(++at, scratch, state);
+                state.swap(scratch);
+            }
+            std::vector<uint16_t> heights(state.size());
+            for (size_t i = 0; i < state.size(); i++)
+                heights[i] = (uint16_t)(state[i] * step);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ready[f].swap(heights);
+            }
+            ready_cv.notify_all();
+        }
+    }
+
+    int width = 0, height = 0;
+    int frame_count = 0;
+    int keyframe_interval = 1;
+    uint32_t step = 1;
+    std::vector<uint64_t> table;
+    std::vector<unsigned char> payload;
+
+    unsigned int slot_tex[2] = { 0, 0 };
+    int slot_frame[2] = { -1, -1 };
+
+    // shared with the worker
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake, ready_cv;
+    std::map<int, std::vector<uint16_t>> ready;
+    int want = 0;
+    bool stop = false;
+};
+#endif
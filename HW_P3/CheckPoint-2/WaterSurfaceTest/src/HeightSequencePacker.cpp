@@ -0,0 +1,93 @@
+/************************************************************************
+     File:        HeightSequencePacker.cpp
+
+     Comment:     offline tool, packs a numbered height map sequence
+                  (000.png, 001.png, ...) into one .hseq file that
+                  TrainView streams instead of the individual images
+
+     usage:       HeightSequencePacker <image dir> <frame count> <out.hseq> [keyframe interval] [bits]
+                  bits quantizes the heights (e.g. 6), leave it out for a lossless pack
+                  HeightSequencePacker --check
+                  packs a made up 16 bit sequence with the largest possible
+                  jumps between frames, opens it and compares every frame
+
+*************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "HeightSequence.h"
+
+// a whole number from min up, false for anything else
+static bool number(const char* text, int min, int& value)
+{
+	char* end;
+	long v = strtol(text, &end, 10);
+	if (end == text || *end || v < min || v > 1 << 30)
+		return false;
+	value = (int)v;
+	return true;
+}
+
+// checkerboards that flip every other frame give residuals of +-2 * 65535 against the previous frame,
+// the frames in between are noise. packed lossless, every frame has to come back exactly
+static int check(const char* out_path)
+{
+	const int width = 61, height = 37, frames = 24, keyframe_interval = 5;
+	std::vector<std::vector<uint16_t>> source(frames);
+	std::mt19937 random(1);
+	for (int f = 0; f < frames; f++) {
+		source[f].resize(width * height);
+		for (int i = 0; i < width * height; i++) {
+			bool black = (i % width + i / width + f / 2) % 2 != 0;
+			source[f][i] = f % 4 == 3 ? (uint16_t)(random() & 0xffff) : (black ? 0 : 65535);
+		}
+	}
+	bool packed = HeightSequence::pack(frames, [&source](size_t f, HeightSequence::Frame& frame) {
+		frame.width = width;
+		frame.height = height;
+		frame.is16 = true;
+		frame.heights = source[f];
+		return true;
+	}, out_path, keyframe_interval);
+	HeightSequence sequence;
+	if (!packed || !sequence.open(out_path)) {
+		printf("check failed: could not pack or open %s\n", out_path);
+		return 1;
+	}
+	std::vector<uint16_t> heights;
+	for (int f = 0; f < frames; f++) {
+		if (!sequence.read(f, heights) || heights != source[f]) {
+			printf("check failed: frame %d does not match\n", f);
+			return 1;
+		}
+	}
+	remove(out_path);
+	printf("check passed: %d frames round trip\n", frames);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc == 2 && std::string(argv[1]) == "--check")
+		return check("check.hseq");
+	int count, keyframe_interval = 25, bits = 0;
+	if (argc < 4 || !number(argv[2], 1, count) || (argc > 4 && !number(argv[4], 1, keyframe_interval)) || (argc > 5 && !number(argv[5], 0, bits))) {
+		printf("usage: %s <image dir> <frame count> <out.hseq> [keyframe interval] [bits]\n", argv[0]);
+		printf("       %s --check\n", argv[0]);
+		printf("frame count and keyframe interval are at least 1, bits is 0 for lossless\n");
+		return 1;
+	}
+
+	std::vector<std::string> images;
+	for (int i = 0; i < count; i++) {
+		char name[16];
+		sprintf(name, "/%03d.png", i);
+		images.push_back(std::string(argv[1]) + name);
+	}
+	if (!HeightSequence::pack(images, argv[3], keyframe_interval, bits))
+		return 1;
+	printf("packed %d frames into %s\n", count, argv[3]);
+	return 0;
+}
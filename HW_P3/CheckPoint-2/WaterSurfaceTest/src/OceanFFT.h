@@ -0,0 +1,264 @@
+#ifndef OCEAN_FFT_H
+#define OCEAN_FFT_H
+
+#include <glad/glad.h>
+
+#include <complex>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+// Tessendorf style ocean, generated on the CPU every tick.
+// A Phillips spectrum is evaluated once per wind setting, advanced in time in frequency space,
+// and brought back with an inverse FFT (rows and columns split across a pool of threads started with the ocean).
+//
+// the result goes into an RGBA16F texture laid out like the height map images:
+//  r : height remapped around 0.5, so the height map shaders can keep using (r - 0.5) * amplitude
+//  g, b : slope along x and z, in the same units per texel
+class OceanFFT
+{
+public:
+    typedef std::complex<float> complex;
+
+    OceanFFT(int _N = 256, float _patch = 64.0f) : N(_N), patch(_patch)
+    {
+        int bits = 0;
+        while ((1 << bits) < N)
+            bits++;
+        reverse.resize(N);
+        for (int i = 0; i < N; i++) {
+            int r = 0;
+            for (int b = 0; b < bits; b++)
+                if (i & (1 << b))
+                    r |= 1 << (bits - 1 - b);
+            reverse[i] = r;
+        }
+        twiddle.resize(N / 2);
+        for (int i = 0; i < N / 2; i++)
+            twiddle[i] = std::polar(1.0f, 2.0f * PI * i / N);
+        h0.resize(N * N);
+        omega.resize(N * N);
+        height.resize(N * N);
+        slope.resize(N * N);
+        pixels.resize(N * N * 4);
+    }
+    OceanFFT(const OceanFFT&) = delete;
+    OceanFFT& operator=(const OceanFFT&) = delete;
+    ~OceanFFT()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        wake.notify_all();
+        for (auto& t : workers)
+            t.join();
+    }
+
+    // regenerates the field at time t, wind speed in m/s. does nothing if neither changed
+    void update(float t, float wind)
+    {
+        if (wind != last_wind)
+            spectrum(wind);
+        if (t == last_time && texture_id)
+            return;
+        last_time = t;
+
+        // h(k, t) = h0(k) e^{iwt} + conj(h0(-k)) e^{-iwt}, slopes are i k h(k, t).
+        // both slopes are real in space, so they share one transform as x + i z
+        parallel(N, [this, t](int begin, int end) {
+            for (int m = begin; m < end; m++) {
+                for (int n = 0; n < N; n++) {
+                    float kx = wave_number(n), kz = wave_number(m);
+                    complex e = std::polar(1.0f, omega[m * N + n] * t);
+                    complex h = h0[m * N + n] * e + std::conj(h0[((N - m) % N) * N + (N - n) % N]) * std::conj(e);
+                    height[m * N + n] = h;
+                    slope[m * N + n] = complex(0, kx) * h + complex(0, 1) * (complex(0, kz) * h);
+                }
+            }
+        });
+        inverse_2d(height);
+        inverse_2d(slope);
+
+        // texel size turns the world slope into a height change per texel
+        float texel = patch / N * normalize;
+        parallel(N, [this, texel](int begin, int end) {
+            for (int i = begin * N; i < end * N; i++) {
+                pixels[i * 4 + 0] = 0.5f + height[i].real() * normalize;
+                pixels[i * 4 + 1] = slope[i].real() * texel;
+                pixels[i * 4 + 2] = slope[i].imag() * texel;
+                pixels[i * 4 + 3] = 1.0f;
+            }
+        });
+
+        if (!texture_id) {
+            glGenTextures(1, &texture_id);
+            glBindTexture(GL_TEXTURE_2D, texture_id);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, N, N, 0, GL_RGBA, GL_FLOAT, NULL);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        }
+        glBindTexture(GL_TEXTURE_2D, texture_id);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, N, N, GL_RGBA, GL_FLOAT, pixels.data());
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    unsigned int texture() const { return texture_id; }
+
+private:
+    const float PI = 3.14159265f;
+    const float GRAVITY = 9.81f;
+
+    float wave_number(int n) const
+    {
+        return 2.0f * PI * (n < N / 2 ? n : n - N) / patch;
+    }
+
+    // Phillips spectrum amplitudes, and the scale that maps three standard deviations of height to 0.5
+    void spectrum(float wind)
+    {
+        last_wind = wind;
+        float L = wind * wind / GRAVITY;
+        float damping = patch / N;
+        std::mt19937 random(1337);
+        std::normal_distribution<float> gauss;
+        double variance = 0.0;
+        for (int m = 0; m < N; m++) {
+            for (int n = 0; n < N; n++) {
+                float kx = wave_number(n), kz = wave_number(m);
+                float k2 = kx * kx + kz * kz;
+                float p = 0.0f;
+                if (k2 > 0.0f) {
+                    // wind blows along x
+                    float cosine = kx / std::sqrt(k2);
+                    p = std::exp(-1.0f / (k2 * L * L)) / (k2 * k2) * cosine * cosine * std::exp(-k2 * damping * damping);
+                }
+                float g0 = gauss(random), g1 = gauss(random);
+                h0[m * N + n] = complex(g0, g1) * std::sqrt(p * 0.5f);
+                // deep water dispersion
+                omega[m * N + n] = std::sqrt(GRAVITY * std::sqrt(k2));
+                variance += 2.0 * std::norm(h0[m * N + n]);
+            }
+        }
+        normalize = variance > 0.0 ? (float)(1.0 / (6.0 * std::sqrt(variance))) : 0.0f;
+        last_time = -1.0f;
+    }
+
+    // in place radix-2 inverse transform of one row with the given stride
+    void inverse_1d(complex* data, int stride, std::vector<complex>& tmp) const
+    {
+        for (int i = 0; i < N; i++)
+            tmp[reverse[i]] = data[i * stride];
+        for (int size = 2; size <= N; size <<= 1) {
+            int half = size / 2, step = N / size;
+            for (int start = 0; start < N; start += size) {
+                for (int j = 0; j < half; j++) {
+                    complex a = tmp[start + j];
+                    complex b = tmp[start + j + half] * twiddle[j * step];
+                    tmp[start + j] = a + b;
+                    tmp[start + j + half] = a - b;
+                }
+            }
+        }
+        for (int i = 0; i < N; i++)
+            data[i * stride] = tmp[i];
+    }
+
+    void inverse_2d(std::vector<complex>& data)
+    {
+        parallel(N, [this, &data](int begin, int end) {
+            std::vector<complex> tmp(N);
+            for (int row = begin; row < end; row++)
+                inverse_1d(&data[row * N], 1, tmp);
+        });
+        parallel(N, [this, &data](int begin, int end) {
+            std::vector<complex> tmp(N);
+            for (int column = begin; column < end; column++)
+                inverse_1d(&data[column], N, tmp);
+        });
+    }
+
+    // runs job over [0, count) split in contiguous ranges, one per hardware thread, and waits for all of them
+    void parallel(int count, const std::function<void(int, int)>& job)
+    {
+        // started the first time, waves that never turn into an ocean don't keep threads around.
+        // the calling thread takes the first range, so one worker less than there are hardware threads
+        if (threads == 0) {
+            threads = (std::max)(1, (int)std::thread::hardware_concurrency());
+            for (int i = 1; i < threads; i++)
+                workers.push_back(std::thread(&OceanFFT::work, this, i));
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            this->job = &job;
+            job_count = count;
+            pending = (int)workers.size();
+            generation++;
+        }
+        wake.notify_all();
+        job(0, count / threads);
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return pending == 0; });
+        this->job = nullptr;
+    }
+
+    // worker index runs its range of every job parallel() hands out
+    void work(int index)
+    {
+        unsigned int seen = 0;
+        for (;;) {
+            const std::function<void(int, int)>* run;
+            int count;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this, seen] { return stop || generation != seen; });
+                if (stop)
+                    return;
+                seen = generation;
+                run = job;
+                count = job_count;
+            }
+            (*run)(count * index / threads, count * (index + 1) / threads);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending--;
+            }
+            done.notify_one();
+        }
+    }
+
+    int N;
+    float patch;
+    float normalize = 0.0f;
+    float last_wind = -1.0f;
+    float last_time = -1.0f;
+    unsigned int texture_id = 0;
+
+    std::vector<int> reverse;
+    std::vector<complex> twiddle;
+    std::vector<complex> h0;
+    std::vector<float> omega;
+    std::vector<complex> height;
+    std::vector<complex> slope;
+    std::vector<float> pixels;
+
+    // the pool, shared with the workers under mutex
+    int threads = 0;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    const std::function<void(int, int)>* job = nullptr;
+    int job_count = 0;
+    int pending = 0;
+    unsigned int generation = 0;
+    bool stop = false;
+};
+#endif
@@ -0,0 +1,97 @@
+#ifndef UNIFORM_RING_H
+#define UNIFORM_RING_H
+
+#include <glad/glad.h>
+
+#include <vector>
+#include <cstring>
+#include <iostream>
+
+// a std140 uniform block that is rewritten once per frame.
+// the buffer holds a few copies of the block and stays mapped for its whole life,
+// each frame writes the next copy and fences it after the last draw that reads it,
+// so the CPU never overwrites a copy the GPU may still be reading.
+class UniformRing
+{
+public:
+	UniformRing(GLuint _binding, GLsizeiptr _size, int _frames = 3)
+		: binding(_binding), size(_size), frames(_frames), fences(_frames, nullptr)
+	{
+		GLint align = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+		this->stride = (this->size + align - 1) / align * align;
+
+		glGenBuffers(1, &this->ubo);
+		glBindBuffer(GL_UNIFORM_BUFFER, this->ubo);
+		if (GLAD_GL_VERSION_4_4)
+		{
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_UNIFORM_BUFFER, this->stride * this->frames, NULL, flags);
+			this->mapped = (char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, this->stride * this->frames, flags);
+			if (!this->mapped)
+				std::cout << "ERROR::UNIFORM_RING::MAP_FAILED" << std::endl;
+		}
+		else
+			// no persistent mapping, fall back to sub data uploads into the same ring
+			glBufferData(GL_UNIFORM_BUFFER, this->stride * this->frames, NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+	UniformRing(const UniformRing&) = delete;
+	UniformRing& operator=(const UniformRing&) = delete;
+	~UniformRing()
+	{
+		for (GLsync f : this->fences)
+			if (f)
+				glDeleteSync(f);
+		if (this->mapped)
+		{
+			glBindBuffer(GL_UNIFORM_BUFFER, this->ubo);
+			glUnmapBuffer(GL_UNIFORM_BUFFER);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		}
+		glDeleteBuffers(1, &this->ubo);
+	}
+
+	// copies the block into the next copy of the ring and binds that copy to the binding point
+	void write(const void* data)
+	{
+		this->current = (this->current + 1) % this->frames;
+		GLsync& f = this->fences[this->current];
+		if (f)
+		{
+			// only blocks when the GPU is more than frames - 1 frames behind
+			glClientWaitSync(f, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+			glDeleteSync(f);
+			f = nullptr;
+		}
+		GLintptr offset = this->stride * this->current;
+		if (this->mapped)
+			memcpy(this->mapped + offset, data, this->size);
+		else
+		{
+			glBindBuffer(GL_UNIFORM_BUFFER, this->ubo);
+			glBufferSubData(GL_UNIFORM_BUFFER, offset, this->size, data);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		}
+		glBindBufferRange(GL_UNIFORM_BUFFER, this->binding, this->ubo, offset, this->size);
+	}
+	// call after the last draw of the frame that reads the block
+	void fence()
+	{
+		GLsync& f = this->fences[this->current];
+		if (f)
+			glDeleteSync(f);
+		f = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+private:
+	GLuint ubo = 0;
+	GLuint binding;
+	GLsizeiptr size;
+	GLsizeiptr stride;
+	int frames;
+	int current = 0;
+	char* mapped = nullptr;
+	std::vector<GLsync> fences;
+};
+#endif
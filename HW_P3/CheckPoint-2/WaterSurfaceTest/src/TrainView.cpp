@@ -44,6 +44,33 @@
 #define STB_IMAGE_STATIC
 #define STB_IMAGE_IMPLEMENTATION
 #include "model.h"
+#include <cfloat>
+
+// uniform handles, resolved per program the first time they are set
+static const Shader::Handle u_screenTexture = Shader::handle("screenTexture");
+static const Shader::Handle u_amplitude = Shader::handle("amplitude");
+static const Shader::Handle u_interactive_amplitude = Shader::handle("interactive_amplitude");
+static const Shader::Handle u_wavelength = Shader::handle("wavelength");
+static const Shader::Handle u_interactive_wavelength = Shader::handle("interactive_wavelength");
+static const Shader::Handle u_speed = Shader::handle("speed");
+static const Shader::Handle u_interactive_speed = Shader::handle("interactive_speed");
+static const Shader::Handle u_Eta = Shader::handle("Eta");
+static const Shader::Handle u_ratio_of_reflect_refract = Shader::handle("ratio_of_reflect_refract");
+static const Shader::Handle u_model = Shader::handle("model");
+static const Shader::Handle u_normal_matrix = Shader::handle("normal_matrix");
+static const Shader::Handle u_model_view = Shader::handle("model_view");
+static const Shader::Handle u_material_diffuse = Shader::handle("material.diffuse");
+static const Shader::Handle u_material_specular = Shader::handle("material.specular");
+static const Shader::Handle u_material_shininess = Shader::handle("material.shininess");
+static const Shader::Handle u_skybox = Shader::handle("skybox");
+static const Shader::Handle u_tiles = Shader::handle("tiles");
+static const Shader::Handle u_drop_point = Shader::handle("drop_point");
+static const Shader::Handle u_drop_time = Shader::handle("drop_time");
+static const Shader::Handle u_interactive_radius = Shader::handle("interactive_radius");
+static const Shader::Handle u_frame_buffer_type = Shader::handle("frame_buffer_type");
+static const Shader::Handle u_screen_w = Shader::handle("screen_w");
+static const Shader::Handle u_screen_h = Shader::handle("screen_h");
+static const Shader::Handle u_t = Shader::handle("t");
 
 #ifdef EXAMPLE_SOLUTION
 #	include "TrainExample/TrainExample.H"
@@ -127,11 +154,11 @@ int TrainView::handle(int event)
 			if ((last_push == FL_LEFT_MOUSE) && (selectedCube >= 0)) {
 				ControlPoint* cp = &m_pTrack->points[selectedCube];
 
-				double r1x, r1y, r1z, r2x, r2y, r2z;
-				getMouseLine(r1x, r1y, r1z, r2x, r2y, r2z);
+				glm::vec3 r1, r2;
+				camera.ray((float)Fl::event_x(), (float)Fl::event_y(), w(), h(), r1, r2);
 
 				double rx, ry, rz;
-				mousePoleGo(r1x, r1y, r1z, r2x, r2y, r2z, 
+				mousePoleGo(r1.x, r1.y, r1.z, r2.x, r2.y, r2.z, 
 								static_cast<double>(cp->pos.x), 
 								static_cast<double>(cp->pos.y),
 								static_cast<double>(cp->pos.z),
@@ -203,23 +230,6 @@ void TrainView::draw()
 	if (gladLoadGL())
 	{
 
-		if (!this->sinwave) {
-			this->sinwave = new
-				Shader(
-					"./Codes/shaders/sinwave.vert",
-					nullptr, nullptr, nullptr,
-					"./Codes/shaders/sinwave.frag");
-		}
-
-		if (!this->height_map) {
-			this->height_map = new
-				Shader(
-					"./Codes/shaders/height_map.vert",
-					nullptr, nullptr, nullptr,
-					"./Codes/shaders/height_map.frag");
-		}
-
-
 		if (!this->skybox) {
 			this->skybox = new
 				Shader(
@@ -360,19 +370,17 @@ void TrainView::draw()
 		}
 
 		if (!this->commom_matrices)
-			this->commom_matrices = new UBO();
-		//this->commom_matrices->size = 2 * sizeof(glm::mat4);
-		//glGenBuffers(1, &this->commom_matrices->ubo);
-		//glBindBuffer(GL_UNIFORM_BUFFER, this->commom_matrices->ubo);
-		//glBufferData(GL_UNIFORM_BUFFER, this->commom_matrices->size, NULL, GL_STATIC_DRAW);
-		//glBindBuffer(GL_UNIFORM_BUFFER, 0);
+			this->commom_matrices = new UniformRing(0, sizeof(FrameUniforms));
+		if (!this->lights)
+			this->lights = new UniformRing(1, sizeof(LightUniforms));
 
 
 		if (!wave) {
 			//wave = new Model("backpack/backpack.obj");
 			//wave = new Model("water/cube.obj");
 			//wave = new Model("water/water.obj");
-			wave = new Model("water/water_bunny.obj");
+			// the obj is only loaded once the grid button is turned off
+			wave = new Model();
 			//wave = new Model("water/plane.obj");
 
 			for (int i = 0;i < 200;i++) {
@@ -386,6 +394,20 @@ void TrainView::draw()
 				wave->add_height_map_texture((num + ".png").c_str(), "Images/height map");
 				//wave->add_height_map_texture((num + ".png").c_str(), "Images/height map2");
 			}
+			// keep at most 64MB of frames on the GPU, prefetching 16 frames ahead
+			wave->height_map_cache.configure(64 << 20, 16);
+			// prefer the packed sequence, pack it once from the images if it is not there yet
+			if (!wave->height_sequence.open("Images/height map.hseq")) {
+				vector<string> frames;
+				for (int i = 0; i < wave->height_map_cache.size(); i++) {
+					char name[16];
+					sprintf(name, "/%03d.png", i);
+					frames.push_back(string("Images/height map") + name);
+				}
+				if (HeightSequence::pack(frames, "Images/height map.hseq"))
+					wave->height_sequence.open("Images/height map.hseq");
+			}
+			tw->height_map_frames = wave->height_map_frames();
 		}
 		
 		if (!this->screen) {
@@ -417,7 +439,7 @@ void TrainView::draw()
 			glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
 
 			screen->Use();
-			glUniform1i(glGetUniformLocation(screen->Program, "screenTexture"),0);
+			screen->setInt(u_screenTexture, 0);
 
 			glGenFramebuffers(1, &screen_framebuffer);
 			glBindFramebuffer(GL_FRAMEBUFFER, screen_framebuffer);
@@ -636,83 +658,90 @@ void TrainView::draw()
 
 	
 
+	// the shading switches are compiled into the water shaders, one variant per combination
+	Shader::Defines defines;
+	if (tw->toon->value())
+		defines.push_back("TOON");
+	if (tw->height_map_flat->value() && tw->waveBrowser->value() != 1)
+		defines.push_back("FLAT_SHADING");
+	if (tw->dir_L->value())
+		defines.push_back("DIR_LIGHT");
+	if (tw->point_L->value())
+		defines.push_back("POINT_LIGHT");
+	if (tw->spot_L->value())
+		defines.push_back("SPOT_LIGHT");
+
 	Shader* choose_wave;
 	if (tw->waveBrowser->value() == 1) {
-		choose_wave = sinwave;
-
-	}
-	else if (tw->waveBrowser->value() == 2) {
-		choose_wave = height_map;
+		choose_wave = Shader::variant(
+			"./Codes/shaders/sinwave.vert",
+			nullptr, nullptr, nullptr,
+			"./Codes/shaders/sinwave.frag", defines);
 	}
 	else {
-		choose_wave = height_map;
+		choose_wave = Shader::variant(
+			"./Codes/shaders/height_map.vert",
+			nullptr, nullptr, nullptr,
+			"./Codes/shaders/height_map.frag", defines);
 	}
 	choose_wave->Use();
 
-	glUniform1i(glGetUniformLocation(choose_wave->Program, "toon_open"), tw->toon->value());
-	//setUBO();
-	//glBindBufferRange(
-		//GL_UNIFORM_BUFFER, /*binding point*/0, this->commom_matrices->ubo, 0, this->commom_matrices->size);
+	// matrices, camera, time and lights go to every shader through the two uniform blocks
+	setUBO();
 
-	wave->height_map_index = tw->height_map_index;//int <- float
+	wave->update_height_map(tw->height_map_index);
+	if (!tw->water_grid->value() && wave->meshes.empty())
+		wave->load("water/water_bunny.obj");
+	// the wave len slider sets the wind speed, which picks the size of the biggest waves
+	if (tw->waveBrowser->value() == 3)
+		wave->ocean.update(tw->ocean_time, 20.0f * tw->wavelength->value());
 
-	GLfloat projection[16];
-	GLfloat view[16];
-	glGetFloatv(GL_PROJECTION_MATRIX, projection);
-	glGetFloatv(GL_MODELVIEW_MATRIX, view);
-	glm::mat4 view_without_translate = glm::mat4(glm::mat3(glm::make_mat4(view)));
-	glm::mat4 view_inv = glm::inverse(glm::make_mat4(view));
-	glm::vec3 my_pos(view_inv[3][0], view_inv[3][1], view_inv[3][2]);
+	GLfloat* projection = glm::value_ptr(camera.projection);
+	GLfloat* view = glm::value_ptr(camera.view);
+	glm::mat4 view_without_translate = glm::mat4(glm::mat3(camera.view));
+	glm::vec3 my_pos = camera.position;
 	//cout << my_pos[0] << ' ' << my_pos[1] << ' ' << my_pos[2] << endl;
 
 	glm::mat4 model = glm::mat4(1.0f);
 	model = glm::translate(model, glm::vec3(0, tw->y_axis->value(), 0));
 	model = glm::scale(model, glm::vec3(tw->scale->value(), tw->scale->value(), tw->scale->value()));
+	// pick the water patches for this view, in the water's own space
+	if (tw->water_lod->value()) {
+		glm::mat4 clip = glm::make_mat4(projection) * glm::make_mat4(view) * model;
+		water_lod.select(clip, glm::vec3(glm::inverse(model) * glm::vec4(my_pos, 1.0f)), (float)tw->water_extent->value());
+	}
 
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "amplitude"), tw->amplitude->value());
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "interactive_amplitude"), tw->interactive_amplitude->value());
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "wavelength"), tw->wavelength->value());
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "interactive_wavelength"), tw->interactive_wavelength->value());
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "time"), tw->time);
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "speed"), tw->wavespeed->value());
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "interactive_speed"), tw->interactive_wavespeed->value());
-
+	choose_wave->setFloat(u_amplitude, tw->amplitude->value());
+	choose_wave->setFloat(u_interactive_amplitude, tw->interactive_amplitude->value());
+	choose_wave->setFloat(u_wavelength, tw->waveBrowser->value() == 3 ? 1.0f : tw->wavelength->value());
+	choose_wave->setFloat(u_interactive_wavelength, tw->interactive_wavelength->value());
+	choose_wave->setFloat(u_speed, tw->wavespeed->value());
+	choose_wave->setFloat(u_interactive_speed, tw->interactive_wavespeed->value());
 
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "Eta"), tw->Eta->value());
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "ratio_of_reflect_refract"), tw->ratio_of_reflect_refract->value());
 
-	GLfloat translation_and_scale[16];
-	glGetFloatv(GL_MODELVIEW_MATRIX, translation_and_scale);
+	choose_wave->setFloat(u_Eta, tw->Eta->value());
+	choose_wave->setFloat(u_ratio_of_reflect_refract, tw->ratio_of_reflect_refract->value());
 
-	glUniform3f(glGetUniformLocation(choose_wave->Program, "viewPos"), my_pos[0], my_pos[1], my_pos[2]);
-	glUniformMatrix4fv(glGetUniformLocation(choose_wave->Program, "projection"), 1, GL_FALSE, projection);
-	glUniformMatrix4fv(glGetUniformLocation(choose_wave->Program, "view"), 1, GL_FALSE, view);
-	glUniformMatrix4fv(glGetUniformLocation(choose_wave->Program, "model"), 1, GL_FALSE, &model[0][0]);
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "material.diffuse"), 0.0f);
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "material.specular"), 1.0f);
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "material.shininess"), 16.0f);
+	// normals only need the rotation and scale part, inverted once here instead of per vertex
+	glm::mat3 normal_matrix = glm::transpose(glm::inverse(glm::mat3(model)));
+	choose_wave->setMat4(u_model, &model[0][0]);
+	choose_wave->setMat3(u_normal_matrix, &normal_matrix[0][0]);
+	choose_wave->setFloat(u_material_diffuse, 0.0f);
+	choose_wave->setFloat(u_material_specular, 1.0f);
+	choose_wave->setFloat(u_material_shininess, 16.0f);
 
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "dir_open"), tw->dir_L->value());
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "point_open"), tw->point_L->value());
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "spot_open"), tw->spot_L->value());
 	//glUniform1f(glGetUniformLocation(choose_wave->Program, "reflect_open"), tw->reflect->value());
 	//glUniform1f(glGetUniformLocation(choose_wave->Program, "refract_open"), tw->refract->value());
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "flat_shading"), tw->height_map_flat->value());
-
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "skybox"), cubemapTexture);
 
+	choose_wave->setFloat(u_skybox, cubemapTexture);
 
-	dir_light(choose_wave);
-	point_light(choose_wave);
-	spot_light(choose_wave,glm::normalize(glm::vec3(0,0,0) - my_pos));
-
-	glUniform2f(glGetUniformLocation(choose_wave->Program, "drop_point"), -1,-1);
+	choose_wave->setVec2(u_drop_point, -1,-1);
 
 
 	glActiveTexture(GL_TEXTURE2);
 	glBindTexture(GL_TEXTURE_2D, tiles_tex);
-	glUniform1i(glGetUniformLocation(choose_wave->Program, "tiles"), 2);
-	wave->Draw(*choose_wave, tw->waveBrowser->value());
+	choose_wave->setInt(u_tiles, 2);
+	wave->Draw(*choose_wave, tw->waveBrowser->value(), water_grid_n(), active_water_lod());
 
 
 	for (int i = 0;i < all_drop.size();i++) {
@@ -721,18 +750,16 @@ void TrainView::draw()
 			i--;
 			continue;
 		}
-		glUniform2f(glGetUniformLocation(choose_wave->Program, "drop_point"), all_drop[i].point.x, all_drop[i].point.y);
-		glUniform1f(glGetUniformLocation(choose_wave->Program, "drop_time"), all_drop[i].time);
-		glUniform1f(glGetUniformLocation(choose_wave->Program, "interactive_radius"), all_drop[i].radius);
-		wave->Draw(*choose_wave, tw->waveBrowser->value());
+		choose_wave->setVec2(u_drop_point, all_drop[i].point.x, all_drop[i].point.y);
+		choose_wave->setFloat(u_drop_time, all_drop[i].time);
+		choose_wave->setFloat(u_interactive_radius, all_drop[i].radius);
+		wave->Draw(*choose_wave, tw->waveBrowser->value(), water_grid_n(), active_water_lod());
 	}
 	glEnable(GL_CULL_FACE);
 	glm::mat4 tiles_model = glm::scale(glm::mat4(1.0f), glm::vec3(tw->scale->value(), tw->scale->value(), tw->scale->value()));
 	tiles->Use();
-	glUniform1f(glGetUniformLocation(tiles->Program, "tiles"), tiles_cubemapTexture);
-	glUniformMatrix4fv(glGetUniformLocation(tiles->Program, "projection"), 1, GL_FALSE, projection);
-	glUniformMatrix4fv(glGetUniformLocation(tiles->Program, "view"), 1, GL_FALSE, view);
-	glUniformMatrix4fv(glGetUniformLocation(tiles->Program, "model"), 1, GL_FALSE, &tiles_model[0][0]);
+	tiles->setFloat(u_tiles, tiles_cubemapTexture);
+	tiles->setMat4(u_model, &tiles_model[0][0]);
 	// skybox cube
 	glBindVertexArray(tilesVAO);
 	glActiveTexture(GL_TEXTURE0);
@@ -745,9 +772,8 @@ void TrainView::draw()
 
 	glDepthFunc(GL_LEQUAL);
 	skybox->Use();
-	glUniform1f(glGetUniformLocation(skybox->Program, "skybox"), cubemapTexture);
-	glUniformMatrix4fv(glGetUniformLocation(skybox->Program, "projection"), 1, GL_FALSE, projection);
-	glUniformMatrix4fv(glGetUniformLocation(skybox->Program, "model_view"), 1, GL_FALSE, &view_without_translate[0][0]);
+	skybox->setFloat(u_skybox, cubemapTexture);
+	skybox->setMat4(u_model_view, &view_without_translate[0][0]);
 	// skybox cube
 	glBindVertexArray(skyboxVAO);
 	glActiveTexture(GL_TEXTURE0);
@@ -766,15 +792,18 @@ void TrainView::draw()
 	glClearColor(1.0f, 1.0f, 1.0f, 1.0f); // set clear color to white (not really necessary actually, since we won't be able to see behind the quad anyways)
 	glClear(GL_COLOR_BUFFER_BIT);
 	this->screen->Use();
-	glUniform1i(glGetUniformLocation(screen->Program, "frame_buffer_type"),tw->frame_buffer_type->value());
-	glUniform1f(glGetUniformLocation(screen->Program, "screen_w"), w());
-	glUniform1f(glGetUniformLocation(screen->Program, "screen_h"), h());
-	glUniform1f(glGetUniformLocation(screen->Program, "t"), tw->time * 20);
+	screen->setInt(u_frame_buffer_type, tw->frame_buffer_type->value());
+	screen->setFloat(u_screen_w, w());
+	screen->setFloat(u_screen_h, h());
+	screen->setFloat(u_t, tw->time * 20);
 	glBindVertexArray(screen_quadVAO);
 	glBindTexture(GL_TEXTURE_2D, screen_textureColorbuffer);	// use the color attachment texture as the texture of the quad plane
 	glDrawArrays(GL_TRIANGLES, 0, 6);
 	//unbind shader(switch to fixed pipeline)
 	glUseProgram(0);
+
+	commom_matrices->fence();
+	lights->fence();
 }
 
 void TrainView::add_drop(float radius,float keep_time) {
@@ -786,21 +815,14 @@ void TrainView::add_drop(float radius,float keep_time) {
 
 	interactive_frame->Use();
 
-	GLfloat View[16];
-	GLfloat Projection[16];
-
-	glGetFloatv(GL_PROJECTION_MATRIX, Projection);
-	glGetFloatv(GL_MODELVIEW_MATRIX, View);
-
+	// projection and view come from the commom_matrices block of the last frame
 	//transformation matrix
 	glm::mat4 model = glm::mat4(1.0f);
 	model = glm::translate(model, glm::vec3(0, tw->y_axis->value(), 0));
 	model = glm::scale(model, glm::vec3(tw->scale->value(), tw->scale->value(), tw->scale->value()));
 
-	glUniformMatrix4fv(glGetUniformLocation(interactive_frame->Program, "projection"), 1, GL_FALSE, Projection);
-	glUniformMatrix4fv(glGetUniformLocation(interactive_frame->Program, "view"), 1, GL_FALSE, View);
-	glUniformMatrix4fv(glGetUniformLocation(interactive_frame->Program, "model"), 1, GL_FALSE, &model[0][0]);
-	wave->Draw(*interactive_frame, tw->waveBrowser->value());
+	interactive_frame->setMat4(u_model, &model[0][0]);
+	wave->Draw(*interactive_frame, tw->waveBrowser->value(), water_grid_n(), active_water_lod());
 
 	glReadBuffer(GL_COLOR_ATTACHMENT0);
 	glm::vec3 uv;
@@ -847,33 +869,40 @@ unsigned int loadCubemap(vector<const GLchar*> faces)
 
 	return textureID;
 }
-void TrainView::dir_light(Shader* choose_wave) {
-	glUniform3f(glGetUniformLocation(choose_wave->Program, "dirLight.direction"), 0.0f, 1.5f, 0.0f);
-	glUniform3f(glGetUniformLocation(choose_wave->Program, "dirLight.ambient"), 1.0f, 1.0f, 0.00f);
-	glUniform3f(glGetUniformLocation(choose_wave->Program, "dirLight.diffuse"), 0.4f, 0.4f, 0.4f);
-	glUniform3f(glGetUniformLocation(choose_wave->Program, "dirLight.specular"), 0.5f, 0.5f, 0.5f);
+// size of the procedural water grid, 0 when the obj mesh is used
+int TrainView::water_grid_n() {
+	return tw->water_grid->value() ? (int)tw->grid_size->value() : 0;
+}
+// the lod quadtree only applies to the procedural grid
+const WaterLOD* TrainView::active_water_lod() {
+	return tw->water_lod->value() && water_grid_n() ? &water_lod : nullptr;
 }
-void TrainView::point_light(Shader* choose_wave) {
-	glUniform3f(glGetUniformLocation(choose_wave->Program, "pointLights.position"), 0, 10, 0);
-	glUniform3f(glGetUniformLocation(choose_wave->Program, "pointLights.direction"), 0.0f, -1.5f, 0.0f);
-	glUniform3f(glGetUniformLocation(choose_wave->Program, "pointLights.ambient"), 1.0f, 0.1f, 0.1f);
-	glUniform3f(glGetUniformLocation(choose_wave->Program, "pointLights.diffuse"), 0.8f, 0.8f, 0.8f);
-	glUniform3f(glGetUniformLocation(choose_wave->Program, "pointLights.specular"), 1.0f, 0.0f, 1.0f);
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "pointLights.constant"), 1.0f);
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "pointLights.linear"), 0.09f);
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "pointLights.quadratic"), 0.032f);
+void TrainView::dir_light(LightUniforms& l) {
+	l.dirLight.direction = glm::vec3(0.0f, 1.5f, 0.0f);
+	l.dirLight.ambient = glm::vec3(1.0f, 1.0f, 0.00f);
+	l.dirLight.diffuse = glm::vec3(0.4f, 0.4f, 0.4f);
+	l.dirLight.specular = glm::vec3(0.5f, 0.5f, 0.5f);
 }
-void TrainView::spot_light(Shader* choose_wave, glm::vec3 front) {
-	glUniform3f(glGetUniformLocation(choose_wave->Program, "spotLight.position"), 0, 5, 0);
-	glUniform3f(glGetUniformLocation(choose_wave->Program, "spotLight.direction"), front[0], front[1], front[2]);
-	glUniform3f(glGetUniformLocation(choose_wave->Program, "spotLight.ambient"), 0.1f, 0.1f, 0.1f);
-	glUniform3f(glGetUniformLocation(choose_wave->Program, "spotLight.diffuse"), 1.0f, 0.0f, 0.0f);
-	glUniform3f(glGetUniformLocation(choose_wave->Program, "spotLight.specular"), 1.0f, 1.0f, 1.0f);
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "spotLight.constant"), 1.0f);
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "spotLight.linear"), 0.09f);
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "spotLight.cutOff"), 0.032f);
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "spotLight.quadratic"), glm::cos(glm::radians(12.5f)));
-	glUniform1f(glGetUniformLocation(choose_wave->Program, "spotLight.outerCutOff"), glm::cos(glm::radians(15.0f)));
+void TrainView::point_light(LightUniforms& l) {
+	l.pointLights.position = glm::vec3(0, 10, 0);
+	l.pointLights.ambient = glm::vec3(1.0f, 0.1f, 0.1f);
+	l.pointLights.diffuse = glm::vec3(0.8f, 0.8f, 0.8f);
+	l.pointLights.specular = glm::vec3(1.0f, 0.0f, 1.0f);
+	l.pointLights.constant = 1.0f;
+	l.pointLights.linear = 0.09f;
+	l.pointLights.quadratic = 0.032f;
+}
+void TrainView::spot_light(LightUniforms& l, glm::vec3 front) {
+	l.spotLight.position = glm::vec3(0, 5, 0);
+	l.spotLight.direction = front;
+	l.spotLight.ambient = glm::vec3(0.1f, 0.1f, 0.1f);
+	l.spotLight.diffuse = glm::vec3(1.0f, 0.0f, 0.0f);
+	l.spotLight.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+	l.spotLight.constant = 1.0f;
+	l.spotLight.linear = 0.09f;
+	l.spotLight.cutOff = 0.032f;
+	l.spotLight.quadratic = glm::cos(glm::radians(12.5f));
+	l.spotLight.outerCutOff = glm::cos(glm::radians(15.0f));
 }
 //************************************************************************
 //
@@ -890,7 +919,7 @@ setProjection()
 
 	// Check whether we use the world camp
 	if (tw->worldCam->value())
-		arcball.setProjection(false);
+		camera.arcball(arcball, aspect, .1f, 1600.0f);
 	// Or we use the top cam
 	else if (tw->topCam->value()) {
 		float wi, he;
@@ -905,11 +934,8 @@ setProjection()
 
 		// Set up the top camera drop mode to be orthogonal and set
 		// up proper projection matrix
-		glMatrixMode(GL_PROJECTION);
-		glOrtho(-wi, wi, -he, he, 200, -200);
-		glMatrixMode(GL_MODELVIEW);
-		glLoadIdentity();
-		glRotatef(-90,1,0,0);
+		camera.projection = glm::ortho(-wi, wi, -he, he, 200.0f, -200.0f);
+		camera.set_view(glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1, 0, 0)));
 	} 
 	// Or do the train view or other view here
 	//####################################################################
@@ -921,6 +947,9 @@ setProjection()
 		trainCamView(this,aspect);
 #endif
 	}
+
+	// the shaders read the matrices from camera, the stacks only serve what is still drawn fixed-function
+	camera.load();
 }
 
 //************************************************************************
@@ -976,7 +1005,7 @@ void TrainView::drawStuff(bool doingShadows)
 //
 // * this tries to see which control point is under the mouse
 //	  (for when the mouse is clicked)
-//		it uses OpenGL picking - which is always a trick
+//		it casts a ray from the camera through the mouse
 //########################################################################
 // TODO: 
 //		if you want to pick things other than control points, or you
@@ -987,71 +1016,44 @@ void TrainView::
 doPick()
 //========================================================================
 {
-	// since we'll need to do some GL stuff so we make this window as 
-	// active window
-	make_current();		
-
+	// camera still holds the matrices of the frame on screen, so no GL is needed here.
 	// where is the mouse?
-	int mx = Fl::event_x(); 
-	int my = Fl::event_y();
-
-	// get the viewport - most reliable way to turn mouse coords into GL coords
-	int viewport[4];
-	glGetIntegerv(GL_VIEWPORT, viewport);
-
-	// Set up the pick matrix on the stack - remember, FlTk is
-	// upside down!
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity ();
-	gluPickMatrix((double)mx, (double)(viewport[3]-my), 
-						5, 5, viewport);
-
-	// now set up the projection
-	setProjection();
-
-	// now draw the objects - but really only see what we hit
-	GLuint buf[100];
-	glSelectBuffer(100,buf);
-	glRenderMode(GL_SELECT);
-	glInitNames();
-	glPushName(0);
-
-	// draw the cubes, loading the names as we go
-	for(size_t i=0; i<m_pTrack->points.size(); ++i) {
-		glLoadName((GLuint) (i+1));
-		m_pTrack->points[i].draw();
+	glm::vec3 from, to;
+	camera.ray((float)Fl::event_x(), (float)Fl::event_y(), w(), h(), from, to);
+	glm::vec3 dir = glm::normalize(to - from);
+
+	// the nearest control point whose cube the ray passes through,
+	// the cubes are tested as spheres that about cover them
+	const float radius = 3.0f;
+	float nearest = FLT_MAX;
+	selectedCube = -1;
+	for (size_t i = 0; i < m_pTrack->points.size(); ++i) {
+		const Pnt3f& p = m_pTrack->points[i].pos;
+		glm::vec3 offset = glm::vec3(p.x, p.y, p.z) - from;
+		float along = glm::dot(offset, dir);
+		if (along < 0 || glm::length(offset - dir * along) > radius)
+			continue;
+		if (along < nearest) {
+			nearest = along;
+			selectedCube = (int)i;
+		}
 	}
-
-	// go back to drawing mode, and see how picking did
-	int hits = glRenderMode(GL_RENDER);
-	if (hits) {
-		// warning; this just grabs the first object hit - if there
-		// are multiple objects, you really want to pick the closest
-		// one - see the OpenGL manual 
-		// remember: we load names that are one more than the index
-		selectedCube = buf[3]-1;
+	if (selectedCube >= 0)
 		printf("Selected Control Point %d\n", selectedCube);
-	} else // nothing hit, nothing selected
-		selectedCube = -1;
-
 }
 
 void TrainView::setUBO()
 {
-	float wdt = this->pixel_w();
-	float hgt = this->pixel_h();
-
-	glm::mat4 view_matrix;
-	glGetFloatv(GL_MODELVIEW_MATRIX, &view_matrix[0][0]);
-	//HMatrix view_matrix; 
-	//this->arcball.getMatrix(view_matrix);
-
-	glm::mat4 projection_matrix;
-	glGetFloatv(GL_PROJECTION_MATRIX, &projection_matrix[0][0]);
-	//projection_matrix = glm::perspective(glm::radians(this->arcball.getFoV()), (GLfloat)wdt / (GLfloat)hgt, 0.01f, 1000.0f);
-
-	glBindBuffer(GL_UNIFORM_BUFFER, this->commom_matrices->ubo);
-	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), &projection_matrix[0][0]);
-	glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), &view_matrix[0][0]);
-	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	FrameUniforms frame;
+	frame.projection = camera.projection;
+	frame.view = camera.view;
+	frame.viewPos = camera.position;
+	frame.time = tw->time;
+	this->commom_matrices->write(&frame);
+
+	LightUniforms light = {};
+	dir_light(light);
+	point_light(light);
+	spot_light(light, glm::normalize(glm::vec3(0, 0, 0) - frame.viewPos));
+	this->lights->write(&light);
 }
\ No newline at end of file
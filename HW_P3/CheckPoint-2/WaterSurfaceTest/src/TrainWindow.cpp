@@ -145,11 +145,12 @@ TrainWindow(const int x, const int y)
 
 		// browser to select spline types
 		// TODO: make sure these choices are the same as what the code supports
-		waveBrowser = new Fl_Browser(605, pty, 120, 50, "wave Type");
+		waveBrowser = new Fl_Browser(605, pty, 120, 60, "wave Type");
 		waveBrowser->type(2);		// select
 		waveBrowser->callback((Fl_Callback*)damageCB, this);
 		waveBrowser->add("sin");
 		waveBrowser->add("height map");
+		waveBrowser->add("ocean");
 		waveBrowser->select(1);
 
 		toon = new Fl_Button(735, pty, 60, 60, "toon");
@@ -169,6 +170,24 @@ TrainWindow(const int x, const int y)
 		height_map_flat = new Fl_Button(605, pty, 180, 20, "height map flat");
 		togglify(height_map_flat,1);
 		pty += 30;
+		water_grid = new Fl_Button(605, pty, 50, 20, "grid");
+		togglify(water_grid, 1);
+		grid_size = new Fl_Value_Slider(660, pty, 135, 20);
+		grid_size->range(8, 512);
+		grid_size->step(1);
+		grid_size->value(128);
+		grid_size->type(FL_HORIZONTAL);
+		grid_size->callback((Fl_Callback*)damageCB, this);
+		pty += 30;
+		water_lod = new Fl_Button(605, pty, 50, 20, "lod");
+		togglify(water_lod);
+		water_extent = new Fl_Value_Slider(660, pty, 135, 20);
+		water_extent->range(1, 64);
+		water_extent->step(1);
+		water_extent->value(8);
+		water_extent->type(FL_HORIZONTAL);
+		water_extent->callback((Fl_Callback*)damageCB, this);
+		pty += 30;
 		dir_L = new Fl_Button(605, pty, 60, 20, "dir");
 		togglify(dir_L);
 		point_L = new Fl_Button(670, pty, 60, 20, "point");
@@ -0,0 +1,134 @@
+#ifndef WATER_LOD_H
+#define WATER_LOD_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cmath>
+
+// continuous distance LOD (CDLOD) quadtree for the water plane.
+// everything is in the water's local space, the plane spans [-extent, extent] in xz.
+// every selected node is drawn as the same n x n grid patch, so far nodes cover more area with the same vertices,
+// and the vertex shader morphs each patch into its parent's grid before the switch happens.
+class WaterLOD
+{
+public:
+    struct Node {
+        glm::vec2 offset;   // min corner in xz
+        float size;
+        int lod;            // 0 is the finest
+    };
+
+    // how far a patch can be displaced up or down, used for the bounding boxes
+    float max_height = 1.0f;
+    // size of the finest patches in local units, 0.25 with 32 quads per patch matches the density of the water obj
+    float finest_size = 0.25f;
+    int patch_n = 32;
+
+    std::vector<Node> nodes;
+    int culled = 0;
+
+    // picks the patches for this frame. clip is projection * view * model
+    void select(const glm::mat4& clip, const glm::vec3& _camera, float _extent)
+    {
+        camera = _camera;
+        extent = _extent;
+        levels = 1;
+        while (finest_size * (1 << (levels - 1)) < 2.0f * extent)
+            levels++;
+        // a node of level l is used up to twice its own size away, so each level doubles the range
+        ranges.resize(levels);
+        for (int l = 0; l < levels; l++)
+            ranges[l] = 2.0f * finest_size * (1 << l);
+        frustum(clip);
+
+        nodes.clear();
+        culled = 0;
+        float root = finest_size * (1 << (levels - 1));
+        glm::vec2 offset(-root * 0.5f);
+        if (!select(offset, root, levels - 1) && visible(offset, root))
+            nodes.push_back({ offset, root, levels - 1 });
+    }
+
+    // distances over which a patch of this lod morphs into the coarser grid
+    glm::vec2 morph_range(int lod) const
+    {
+        float end = ranges[lod];
+        float start = lod ? ranges[lod - 1] : 0.0f;
+        return glm::vec2(start + (end - start) * 0.66f, end);
+    }
+
+    const glm::vec3& camera_position() const { return camera; }
+
+private:
+    glm::vec3 camera;
+    float extent = 1.0f;
+    int levels = 1;
+    std::vector<float> ranges;
+    glm::vec4 planes[6];
+
+    // false means the node is out of range for this lod and its parent has to draw it
+    bool select(glm::vec2 offset, float size, int lod)
+    {
+        if (!in_range(offset, size, ranges[lod]))
+            return false;
+        if (!visible(offset, size)) {
+            culled++;
+            return true;
+        }
+        if (lod == 0 || !in_range(offset, size, ranges[lod - 1])) {
+            nodes.push_back({ offset, size, lod });
+            return true;
+        }
+        float half = size * 0.5f;
+        for (int i = 0; i < 4; i++) {
+            glm::vec2 child = offset + glm::vec2(i & 1 ? half : 0.0f, i & 2 ? half : 0.0f);
+            // a quadrant the children don't cover is still a patch at their density, so it morphs with their range.
+            // it is past the end of that range, so it is fully morphed to this level's grid and matches its neighbours
+            if (!select(child, half, lod - 1) && visible(child, half))
+                nodes.push_back({ child, half, lod - 1 });
+        }
+        return true;
+    }
+
+    // clamped to the plane, the root is a power of two and may stick out past extent
+    bool inside(glm::vec2 offset, float size) const
+    {
+        return offset.x < extent && offset.y < extent && offset.x + size > -extent && offset.y + size > -extent;
+    }
+
+    bool in_range(glm::vec2 offset, float size, float range) const
+    {
+        glm::vec3 lo(offset.x, -max_height, offset.y), hi(offset.x + size, max_height, offset.y + size);
+        glm::vec3 d = glm::max(glm::max(lo - camera, camera - hi), glm::vec3(0.0f));
+        return glm::dot(d, d) <= range * range;
+    }
+
+    bool visible(glm::vec2 offset, float size) const
+    {
+        if (!inside(offset, size))
+            return false;
+        glm::vec3 lo(offset.x, -max_height, offset.y), hi(offset.x + size, max_height, offset.y + size);
+        for (int i = 0; i < 6; i++) {
+            glm::vec3 p(planes[i].x > 0 ? hi.x : lo.x, planes[i].y > 0 ? hi.y : lo.y, planes[i].z > 0 ? hi.z : lo.z);
+            if (glm::dot(glm::vec3(planes[i]), p) + planes[i].w < 0)
+                return false;
+        }
+        return true;
+    }
+
+    // Gribb/Hartmann plane extraction, the planes end up in the water's local space
+    void frustum(const glm::mat4& m)
+    {
+        glm::vec4 row[4];
+        for (int i = 0; i < 4; i++)
+            row[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+        planes[0] = row[3] + row[0];
+        planes[1] = row[3] - row[0];
+        planes[2] = row[3] + row[1];
+        planes[3] = row[3] - row[1];
+        planes[4] = row[3] + row[2];
+        planes[5] = row[3] - row[2];
+    }
+};
+#endif
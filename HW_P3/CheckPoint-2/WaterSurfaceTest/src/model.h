@@ -11,6 +11,10 @@
 #include "assimp/postprocess.h"
 #include "stb_image.h"
 #include "mesh.h"
+#include "HeightMapCache.h"
+#include "HeightSequence.h"
+#include "OceanFFT.h"
+#include "WaterLOD.h"
 #include "RenderUtilities/Shader.h"
 
 #include <string>
@@ -30,38 +34,138 @@ public:
     vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
     vector<Mesh>    meshes;
     vector<Mesh>    height_map_meshes;
-    vector<unsigned int> height_map_id;
-    int height_map_index = 0;
+    HeightMapCache  height_map_cache;   // height map frames, streamed in and evicted on demand
+    HeightSequence  height_sequence;    // packed height map animation, used instead of the cache when open
+    OceanFFT        ocean;              // generated height field for the "ocean" wave type
+    float height_map_index = 0;
+    float height_map_blend = 0;         // how far we are from the current frame to the next one
     string directory;
     bool gammaCorrection;
+    unsigned int    grid_vao = 0;       // empty vao for the procedural grid, the vertex shader makes up the vertices
     // constructor, expects a filepath to a 3D model.
     Model(string const& path, bool gamma = false) : gammaCorrection(gamma)
     {
         loadModel(path);
     }
+    // empty model, for water that is drawn as a procedural grid until a mesh is asked for
+    Model() : gammaCorrection(false)
+    {
+    }
+    void load(string const& path)
+    {
+        loadModel(path);
+    }
 
-    // draws the model, and thus all its meshes
-    void Draw(Shader& shader,int wave_type)
+    // draws the model, and thus all its meshes. grid_n > 0 draws a grid_n x grid_n procedural grid instead,
+    // and with lod the grid is split into the patches the quadtree selected
+    void Draw(Shader& shader,int wave_type, int grid_n = 0, const WaterLOD* lod = nullptr)
     {
-        if(wave_type == 2){
-            for (unsigned int i = 0; i < height_map_meshes.size(); i++) {
+        static const Shader::Handle u_height_map_next = Shader::handle("height_map_next");
+        static const Shader::Handle u_height_blend = Shader::handle("height_blend");
+        static const Shader::Handle u_height_map_slopes = Shader::handle("height_map_slopes");
+        static const Shader::Handle u_texture_diffuse1 = Shader::handle("texture_diffuse1");
+        static const Shader::Handle u_height_map_texture = Shader::handle("height_map_texture");
+
+        if(wave_type == 2 || wave_type == 3){
+            unsigned int height_map_id, height_map_next_id;
+            float blend = height_map_blend;
+            if (wave_type == 3) {
+                height_map_id = height_map_next_id = ocean.texture();
+                blend = 0.0f;
+            }
+            else if (height_sequence.is_open()) {
+                height_map_id = height_sequence.current();
+                height_map_next_id = height_sequence.next();
+            }
+            else {
+                height_map_id = height_map_cache.get((int)height_map_index);
+                height_map_next_id = height_map_cache.get((int)height_map_index + 1);
+            }
+            // the following frame sits on unit 3 so the shader can blend towards it
+            glActiveTexture(GL_TEXTURE3);
+            glBindTexture(GL_TEXTURE_2D, height_map_next_id);
+            shader.setInt(u_height_map_next, 3);
+            shader.setFloat(u_height_blend, blend);
+            // the ocean texture carries its own slopes in g and b
+            shader.setInt(u_height_map_slopes, wave_type == 3);
+            if (grid_n > 0) {
+                glActiveTexture(GL_TEXTURE0);
+                shader.setInt(u_texture_diffuse1, 0);
+                shader.setInt(u_height_map_texture, 0);
+                glBindTexture(GL_TEXTURE_2D, height_map_id);
+                DrawGrid(shader, grid_n, lod);
+            }
+            for (unsigned int i = 0; grid_n <= 0 && i < height_map_meshes.size(); i++) {
                 for (auto& j : height_map_meshes[i].textures) {
-                    j.id = height_map_id[height_map_index];
+                    j.id = height_map_id;
                 }
                 glActiveTexture(GL_TEXTURE0 + i);
-                glUniform1i(glGetUniformLocation(shader.Program, "height_map_texture"), height_map_id[height_map_index]);
-                glBindTexture(GL_TEXTURE_2D, height_map_id[height_map_index]);
+                shader.setInt(u_height_map_texture, i);
+                glBindTexture(GL_TEXTURE_2D, height_map_id);
                 height_map_meshes[i].Draw(shader);
             }
             glActiveTexture(GL_TEXTURE0);
         }
+        else if (grid_n > 0) {
+            DrawGrid(shader, grid_n, lod);
+        }
         else {
             for (unsigned int i = 0; i < meshes.size(); i++)
                 meshes[i].Draw(shader);
         }
     }
+    // n x n quads over [-1, 1] in xz like the water obj, one instanced triangle strip per row
+    void DrawGrid(Shader& shader, int n, const WaterLOD* lod = nullptr)
+    {
+        static const Shader::Handle u_procedural_grid = Shader::handle("procedural_grid");
+        static const Shader::Handle u_cdlod = Shader::handle("cdlod");
+        static const Shader::Handle u_grid_n = Shader::handle("grid_n");
+        static const Shader::Handle u_camera_local = Shader::handle("camera_local");
+        static const Shader::Handle u_patch_rect = Shader::handle("patch_rect");
+        static const Shader::Handle u_morph_range = Shader::handle("morph_range");
+
+        if (!grid_vao)
+            glGenVertexArrays(1, &grid_vao);
+        shader.setInt(u_procedural_grid, 1);
+        glBindVertexArray(grid_vao);
+        if (lod) {
+            glm::vec3 camera = lod->camera_position();
+            shader.setInt(u_cdlod, 1);
+            shader.setInt(u_grid_n, lod->patch_n);
+            shader.setVec3(u_camera_local, camera.x, camera.y, camera.z);
+            GLint rect = shader.location(u_patch_rect);
+            GLint morph = shader.location(u_morph_range);
+            for (auto& node : lod->nodes) {
+                glm::vec2 range = lod->morph_range(node.lod);
+                glUniform3f(rect, node.offset.x, node.offset.y, node.size);
+                glUniform2f(morph, range.x, range.y);
+                glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 2 * (lod->patch_n + 1), lod->patch_n);
+            }
+            shader.setInt(u_cdlod, 0);
+        }
+        else {
+            shader.setInt(u_grid_n, n);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 2 * (n + 1), n);
+        }
+        glBindVertexArray(0);
+        shader.setInt(u_procedural_grid, 0);
+    }
     void add_height_map_texture(const char* _path, const string& _directory) {
-        height_map_id.push_back(TextureFromFile(_path, _directory));
+        height_map_cache.add_frame(_directory + '/' + string(_path));
+    }
+    int height_map_frames() const {
+        return height_sequence.is_open() ? height_sequence.size() : height_map_cache.size();
+    }
+    // call once per frame before drawing, makes the frames around index resident
+    void update_height_map(float index) {
+        height_map_index = index;
+        if (height_sequence.is_open()) {
+            height_map_blend = height_sequence.update(index);
+        }
+        else {
+            height_map_cache.update((int)index);
+            height_map_blend = index - (float)(int)index;
+        }
     }
 private:
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
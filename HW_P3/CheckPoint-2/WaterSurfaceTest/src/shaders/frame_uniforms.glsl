@@ -0,0 +1,8 @@
+// per frame constants, written once per frame by TrainView::setUBO
+layout (std140, binding = 0) uniform commom_matrices
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    float time;
+};
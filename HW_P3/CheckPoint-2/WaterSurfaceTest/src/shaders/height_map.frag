@@ -2,42 +2,7 @@
 #extension GL_NV_shadow_samplers_cube : enable
 out vec4 f_color;
 
-struct DirLight {
-    vec3 direction;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};  
-
-struct SpotLight {
-    vec3 position;
-    vec3 direction;
-    float cutOff;
-    float outerCutOff;
-  
-    float constant;
-    float linear;
-    float quadratic;
-  
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;       
-};
-
-uniform SpotLight spotLight;
-struct PointLight {    
-    vec3 position;
-    
-    float constant;
-    float linear;
-    float quadratic;  
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};  
- 
-uniform PointLight pointLights;
+#include "lights.glsl"
 
 struct Material
 {
@@ -54,9 +19,7 @@ in V_OUT
    vec2 texture_coordinate;
 } f_in;
  
-uniform DirLight dirLight;
-
-uniform vec3 viewPos;
+#include "frame_uniforms.glsl"
 
 uniform sampler2D u_texture;
 
@@ -66,15 +29,31 @@ uniform sampler2D texture_normal1;
 uniform sampler2D texture_height1;
 
 uniform sampler2D height_map_texture;
+uniform sampler2D height_map_next;
+uniform float height_blend;
+uniform bool height_map_slopes = false;
 
 
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);  
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 
-uniform bool dir_open;
-uniform bool point_open;
-uniform bool spot_open;
+// lights, toon and flat shading are compile time switches, TrainView picks the variant with the matching defines
+#ifdef DIR_LIGHT
+const bool dir_open = true;
+#else
+const bool dir_open = false;
+#endif
+#ifdef POINT_LIGHT
+const bool point_open = true;
+#else
+const bool point_open = false;
+#endif
+#ifdef SPOT_LIGHT
+const bool spot_open = true;
+#else
+const bool spot_open = false;
+#endif
 
 uniform bool reflect_open;
 uniform bool refract_open;
@@ -83,7 +62,11 @@ uniform float Eta;
 uniform float ratio_of_reflect_refract = 0.5f;
 
 uniform samplerCube skybox;
-uniform bool toon_open;
+#ifdef TOON
+const bool toon_open = true;
+#else
+const bool toon_open = false;
+#endif
 
 const float PI = 3.1415926;
 uniform vec2 u_delta = vec2(10.0f,10.0f);
@@ -92,7 +75,11 @@ uniform float u_radius = 0.03f;
 uniform float u_strength = 0.01f;
 
 uniform float amplitude;
-uniform bool flat_shading = true;
+#ifdef FLAT_SHADING
+const bool flat_shading = true;
+#else
+const bool flat_shading = false;
+#endif
 
 uniform sampler2D tiles;
 const float poolHeight = 1.0;
@@ -181,10 +168,18 @@ void main()
         const ivec3 off = ivec3(-1,0,1);
         vec4 wave = texture(height_map_texture, f_in.texture_coordinate);
         float s11 = wave.x;
-        float s01 = (textureOffset(height_map_texture, f_in.texture_coordinate, off.xy).r - 0.5f) * amplitude;
-        float s21 = (textureOffset(height_map_texture,  f_in.texture_coordinate, off.zy).r - 0.5f) * amplitude;
-        float s10 = (textureOffset(height_map_texture,  f_in.texture_coordinate, off.yx).r - 0.5f) * amplitude;
-        float s12 = (textureOffset(height_map_texture,  f_in.texture_coordinate, off.yz).r - 0.5f) * amplitude;
+        float s01, s21, s10, s12;
+        if(height_map_slopes){
+            vec2 slope = texture(height_map_texture, f_in.texture_coordinate).gb * amplitude;
+            s01 = -slope.x; s21 = slope.x;
+            s10 = -slope.y; s12 = slope.y;
+        }
+        else{
+            s01 = (mix(textureOffset(height_map_texture, f_in.texture_coordinate, off.xy).r, textureOffset(height_map_next, f_in.texture_coordinate, off.xy).r, height_blend) - 0.5f) * amplitude;
+            s21 = (mix(textureOffset(height_map_texture, f_in.texture_coordinate, off.zy).r, textureOffset(height_map_next, f_in.texture_coordinate, off.zy).r, height_blend) - 0.5f) * amplitude;
+            s10 = (mix(textureOffset(height_map_texture, f_in.texture_coordinate, off.yx).r, textureOffset(height_map_next, f_in.texture_coordinate, off.yx).r, height_blend) - 0.5f) * amplitude;
+            s12 = (mix(textureOffset(height_map_texture, f_in.texture_coordinate, off.yz).r, textureOffset(height_map_next, f_in.texture_coordinate, off.yz).r, height_blend) - 0.5f) * amplitude;
+        }
         vec3 va = normalize(vec3(size.x, s21-s01, size.y));      
         vec3 vb = normalize(vec3(size.y, s12-s10, -size.x));
         norm = cross(va,vb);
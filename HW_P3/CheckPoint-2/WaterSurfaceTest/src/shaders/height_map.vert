@@ -5,11 +5,20 @@ layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 texture_coordinate;
 
 
-uniform mat4 view;
+#include "frame_uniforms.glsl"
+
 uniform mat4 model;
-uniform mat4 projection;
+uniform mat3 normal_matrix;     // transpose(inverse(model)), computed once on the CPU
+uniform bool procedural_grid = false;
+uniform int grid_n;
+uniform bool cdlod = false;
+uniform vec3 patch_rect;        // xz offset and size of the patch, for cdlod
+uniform vec2 morph_range;
+uniform vec3 camera_local;
 uniform sampler2D texture_diffuse1;
-uniform float amplitude,wavelength,time,speed,interactive_amplitude,interactive_wavelength,interactive_speed,interactive_radius;
+uniform sampler2D height_map_next;
+uniform float height_blend;
+uniform float amplitude,wavelength,speed,interactive_amplitude,interactive_wavelength,interactive_speed,interactive_radius;
 
 uniform vec2 drop_point;
 uniform float drop_time;
@@ -23,11 +32,30 @@ out V_OUT
 
 void main()
 {
-    vec3 height_map = position;
-    float tmp_height = (texture(texture_diffuse1,texture_coordinate/wavelength).r-0.5f) * amplitude;
+    vec3 grid_position = position;
+    vec3 grid_normal = normal;
+    vec2 grid_uv = texture_coordinate;
+    if(procedural_grid){
+        // one triangle strip per row of the grid, even vertices on this row and odd ones on the next
+        grid_uv = vec2(gl_VertexID / 2, gl_InstanceID + gl_VertexID % 2) / float(grid_n);
+        grid_position = vec3(grid_uv.x * 2.0f - 1.0f, 0.0f, grid_uv.y * 2.0f - 1.0f);
+        if(cdlod){
+            // slide the odd vertices onto the parent's grid as the patch nears the end of its range
+            vec2 local = patch_rect.xy + grid_uv * patch_rect.z;
+            float k = clamp((distance(vec3(local.x, 0.0f, local.y), camera_local) - morph_range.x) / (morph_range.y - morph_range.x), 0.0f, 1.0f);
+            vec2 g = grid_uv - fract(grid_uv * float(grid_n) * 0.5f) * 2.0f / float(grid_n) * k;
+            local = patch_rect.xy + g * patch_rect.z;
+            grid_position = vec3(local.x, 0.0f, local.y);
+            grid_uv = (local + 1.0f) * 0.5f;
+        }
+        grid_normal = vec3(0.0f, 1.0f, 0.0f);
+    }
+    vec3 height_map = grid_position;
+    vec2 height_uv = grid_uv/wavelength;
+    float tmp_height = (mix(texture(texture_diffuse1,height_uv).r, texture(height_map_next,height_uv).r, height_blend)-0.5f) * amplitude;
     float tmp_interactive = 0.0f;
     if(drop_point.x >0.0f){        
-        float dist = distance(texture_coordinate, drop_point) / interactive_wavelength * 100;
+        float dist = distance(grid_uv, drop_point) / interactive_wavelength * 100;
         float t_c = (time-drop_time)*(interactive_radius*3.1415926)*interactive_speed;
         tmp_interactive = interactive_amplitude * sin((dist-t_c)*clamp(0.0125*t_c,0,1))/(exp(0.1*abs(dist-t_c)+(0.05*t_c)))*1.5;
     }
@@ -39,6 +67,6 @@ void main()
     }
     gl_Position = projection * view * model * vec4(height_map, 1.0f);
     v_out.position = vec3(model * vec4(height_map, 1.0));
-    v_out.normal = mat3(transpose(inverse(model))) * normal;
-    v_out.texture_coordinate = texture_coordinate;
+    v_out.normal = normal_matrix * grid_normal;
+    v_out.texture_coordinate = grid_uv;
 }
@@ -1,16 +1,38 @@
-#version 330 core
+#version 430 core
 layout (location = 0) in vec3 aPos;
 layout (location = 2) in vec2 aTexCoords;
 
 out vec2 TexCoords;
-uniform mat4 view;
+#include "frame_uniforms.glsl"
+
 uniform mat4 model;
-uniform mat4 projection;
+uniform bool procedural_grid = false;
+uniform int grid_n;
+uniform bool cdlod = false;
+uniform vec3 patch_rect;        // xz offset and size of the patch, for cdlod
+uniform vec2 morph_range;
+uniform vec3 camera_local;
 
 
 void main()
 {
-    TexCoords = aTexCoords;
-    gl_Position =projection * view * model * vec4(aPos, 1.0); 
+    vec3 grid_position = aPos;
+    vec2 grid_uv = aTexCoords;
+    if(procedural_grid){
+        // one triangle strip per row of the grid, even vertices on this row and odd ones on the next
+        grid_uv = vec2(gl_VertexID / 2, gl_InstanceID + gl_VertexID % 2) / float(grid_n);
+        grid_position = vec3(grid_uv.x * 2.0f - 1.0f, 0.0f, grid_uv.y * 2.0f - 1.0f);
+        if(cdlod){
+            // slide the odd vertices onto the parent's grid as the patch nears the end of its range
+            vec2 local = patch_rect.xy + grid_uv * patch_rect.z;
+            float k = clamp((distance(vec3(local.x, 0.0f, local.y), camera_local) - morph_range.x) / (morph_range.y - morph_range.x), 0.0f, 1.0f);
+            vec2 g = grid_uv - fract(grid_uv * float(grid_n) * 0.5f) * 2.0f / float(grid_n) * k;
+            local = patch_rect.xy + g * patch_rect.z;
+            grid_position = vec3(local.x, 0.0f, local.y);
+            grid_uv = (local + 1.0f) * 0.5f;
+        }
+    }
+    TexCoords = grid_uv;
+    gl_Position =projection * view * model * vec4(grid_position, 1.0); 
 
 }
\ No newline at end of file
@@ -2,42 +2,7 @@
 #extension GL_NV_shadow_samplers_cube : enable
 out vec4 f_color;
 
-struct DirLight {
-    vec3 direction;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};  
-
-struct SpotLight {
-    vec3 position;
-    vec3 direction;
-    float cutOff;
-    float outerCutOff;
-  
-    float constant;
-    float linear;
-    float quadratic;
-  
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;       
-};
-
-uniform SpotLight spotLight;
-struct PointLight {    
-    vec3 position;
-    
-    float constant;
-    float linear;
-    float quadratic;  
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};  
- 
-uniform PointLight pointLights;
+#include "lights.glsl"
 
 struct Material
 {
@@ -54,9 +19,7 @@ in V_OUT
    vec2 texture_coordinate;
 } f_in;
  
-uniform DirLight dirLight;
-
-uniform vec3 viewPos;
+#include "frame_uniforms.glsl"
 
 uniform sampler2D u_texture;
 
@@ -69,9 +32,22 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 
-uniform bool dir_open;
-uniform bool point_open;
-uniform bool spot_open;
+// lights, toon and flat shading are compile time switches, TrainView picks the variant with the matching defines
+#ifdef DIR_LIGHT
+const bool dir_open = true;
+#else
+const bool dir_open = false;
+#endif
+#ifdef POINT_LIGHT
+const bool point_open = true;
+#else
+const bool point_open = false;
+#endif
+#ifdef SPOT_LIGHT
+const bool spot_open = true;
+#else
+const bool spot_open = false;
+#endif
 
 uniform bool reflect_open;
 uniform bool refract_open;
@@ -80,7 +56,11 @@ uniform float Eta;
 uniform float ratio_of_reflect_refract = 0.5f;
 
 uniform samplerCube skybox;
-uniform bool toon_open;
+#ifdef TOON
+const bool toon_open = true;
+#else
+const bool toon_open = false;
+#endif
 
 uniform sampler2D tiles;
 const float poolHeight = 1;
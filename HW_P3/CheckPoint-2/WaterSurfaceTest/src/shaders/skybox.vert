@@ -1,8 +1,9 @@
-#version 330 core
+#version 430 core
 layout (location = 0) in vec3 position;
 out vec3 TexCoords;
 
-uniform mat4 projection;
+#include "frame_uniforms.glsl"
+
 uniform mat4 model_view;
 
 
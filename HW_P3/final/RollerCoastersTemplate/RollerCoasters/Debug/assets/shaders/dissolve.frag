@@ -5,7 +5,7 @@ in vec2 TexCoords;
 in vec3 worldFragPos;
 
 uniform sampler2D diffuseTexture;   // Base texture of the mesh
-uniform float dissolveFactor;       // Controls how much of the object dissolves
+in float dissolveFactor;            // Controls how much of the object dissolves
 //uniform vec4 edgeColor;             // Color for edges of the dissolve effect
 
 // Simple hash function to generate pseudo-random noise
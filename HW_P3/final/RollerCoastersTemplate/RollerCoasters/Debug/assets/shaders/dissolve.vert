@@ -2,17 +2,23 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+// per instance
+layout (location = 5) in mat4 aInstanceModel;
+layout (location = 9) in vec2 aDissolvePhase;
 
 out vec2 TexCoords;
 out vec3 worldFragPos;
+out float dissolveFactor;
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform float time;
 
 void main()
 {
-    worldFragPos = (model * vec4(aPos, 1.0)).xyz;
-    TexCoords = aTexCoords;    
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-}
\ No newline at end of file
+    worldFragPos = (aInstanceModel * vec4(aPos, 1.0)).xyz;
+    TexCoords = aTexCoords;
+    // each flower breathes in and out around its own dissolve level
+    dissolveFactor = 0.5 * (aDissolvePhase.x + sin(time + aDissolvePhase.y));
+    gl_Position = projection * view * vec4(worldFragPos, 1.0);
+}
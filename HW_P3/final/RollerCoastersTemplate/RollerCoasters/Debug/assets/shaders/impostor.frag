@@ -0,0 +1,38 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 FrameLocal[4];
+flat in vec2 Frame[4];
+flat in vec4 FrameWeights;
+in vec3 worldPos;
+flat in float worldRadius;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 cameraPos;
+uniform int impostor_frames;
+uniform sampler2D impostor_albedo;
+uniform sampler2D impostor_normal_depth;
+
+void main()
+{
+    // half a texel in from the edges, so a view never bleeds into its neighbours
+    vec2 inset = 0.5 * float(impostor_frames) / vec2(textureSize(impostor_albedo, 0));
+    vec4 color = vec4(0.0);
+    float depth = 0.0;
+    for (int i = 0; i < 4; i++) {
+        vec2 uv = (Frame[i] + clamp(FrameLocal[i] * 0.5 + 0.5, inset, 1.0 - inset)) / float(impostor_frames);
+        vec4 albedo = texture(impostor_albedo, uv);
+        color += FrameWeights[i] * albedo;
+        depth += FrameWeights[i] * albedo.a * (texture(impostor_normal_depth, uv).a * 2.0 - 1.0);
+    }
+    // cut out like the billboards, no sorting needed
+    if (color.a < 0.5)
+        discard;
+
+    // the baked surface is in front of or behind the quad
+    vec3 surface = worldPos + normalize(cameraPos - worldPos) * depth / color.a * worldRadius;
+    vec4 clip = projection * view * vec4(surface, 1.0);
+    gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+    FragColor = vec4(color.rgb / color.a, 1.0);
+}
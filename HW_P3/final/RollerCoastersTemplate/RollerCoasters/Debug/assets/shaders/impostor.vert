@@ -0,0 +1,69 @@
+#version 330 core
+layout (location = 0) in vec2 aCorner;
+// per instance, any rotation and a uniform scale
+layout (location = 5) in mat4 aInstanceModel;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 cameraPos;
+uniform vec3 impostor_center;
+uniform float impostor_radius;
+uniform int impostor_frames;
+
+// the four baked views around the one the quad is seen from, each with the quad's point on that view's plane
+out vec2 FrameLocal[4];
+flat out vec2 Frame[4];
+flat out vec4 FrameWeights;
+out vec3 worldPos;
+flat out float worldRadius;
+
+// the hemi-octahedron, p in -1..1 to a direction with y >= 0 and back. Impostor::direction is the same
+vec3 decode(vec2 p)
+{
+    vec2 t = vec2(p.x + p.y, p.x - p.y) * 0.5;
+    return normalize(vec3(t.x, 1.0 - abs(t.x) - abs(t.y), t.y));
+}
+vec2 encode(vec3 v)
+{
+    v.y = max(v.y, 0.0);
+    v /= abs(v.x) + abs(v.y) + abs(v.z);
+    return vec2(v.x + v.z, v.x - v.z);
+}
+
+// the axes of a view looking back along d, the ones glm::lookAt gave it when it was baked
+void axes(vec3 d, out vec3 right, out vec3 up)
+{
+    vec3 reference = abs(d.y) > 0.999 ? vec3(0.0, 0.0, -1.0) : vec3(0.0, 1.0, 0.0);
+    right = normalize(cross(reference, d));
+    up = cross(d, right);
+}
+
+void main()
+{
+    mat3 rotation = mat3(aInstanceModel);
+    worldRadius = impostor_radius * length(rotation[0]);
+    vec3 worldCenter = (aInstanceModel * vec4(impostor_center, 1.0)).xyz;
+    // where the camera is seen from in model space, the scale goes away with the normalize
+    vec3 v = normalize(transpose(rotation) * (cameraPos - worldCenter));
+    vec3 right, up;
+    axes(v, right, up);
+    vec3 corner = (right * aCorner.x + up * aCorner.y) * impostor_radius;
+
+    float last = float(impostor_frames - 1);
+    vec2 grid = (encode(v) * 0.5 + 0.5) * last;
+    vec2 base = clamp(floor(grid), 0.0, last - 1.0);
+    vec2 f = clamp(grid - base, 0.0, 1.0);
+    FrameWeights = vec4((1.0 - f.x) * (1.0 - f.y), f.x * (1.0 - f.y), (1.0 - f.x) * f.y, f.x * f.y);
+    for (int i = 0; i < 4; i++) {
+        Frame[i] = base + vec2(i & 1, i >> 1);
+        vec3 d = decode(Frame[i] / last * 2.0 - 1.0);
+        vec3 frame_right, frame_up;
+        axes(d, frame_right, frame_up);
+        // along the line of sight onto the plane the view was baked on, that is linear so the fragments can interpolate it
+        vec3 onFrame = corner - v * (dot(corner, d) / max(dot(v, d), 0.05));
+        FrameLocal[i] = vec2(dot(onFrame, frame_right), dot(onFrame, frame_up)) / impostor_radius;
+    }
+
+    worldPos = (aInstanceModel * vec4(impostor_center + corner, 1.0)).xyz;
+    gl_Position = projection * view * vec4(worldPos, 1.0);
+}
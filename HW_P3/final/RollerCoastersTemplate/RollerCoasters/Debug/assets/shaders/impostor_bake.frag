@@ -0,0 +1,21 @@
+#version 330 core
+layout (location = 0) out vec4 Albedo;
+layout (location = 1) out vec4 NormalDepth;
+
+in vec2 TexCoords;
+in vec3 modelPos;
+in vec3 modelNormal;
+
+uniform sampler2D texture1;
+uniform vec3 impostor_center;
+uniform float impostor_radius;
+uniform vec3 impostor_direction;    // the view being baked, from the center toward the eye
+
+void main()
+{
+    // the same color model_texture gives the mesh
+    Albedo = vec4(texture(texture1, TexCoords).rgb, 1.0);
+    // how far in front of the plane through the center, 0 to 1 over the sphere
+    float depth = dot(modelPos - impostor_center, impostor_direction) / impostor_radius * 0.5 + 0.5;
+    NormalDepth = vec4(normalize(modelNormal) * 0.5 + 0.5, depth);
+}
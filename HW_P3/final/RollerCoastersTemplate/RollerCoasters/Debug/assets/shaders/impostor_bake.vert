@@ -0,0 +1,20 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+out vec3 modelPos;
+out vec3 modelNormal;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    modelPos = (model * vec4(aPos, 1.0)).xyz;
+    modelNormal = mat3(model) * aNormal;
+    TexCoords = aTexCoords;
+    gl_Position = projection * view * vec4(modelPos, 1.0);
+}
@@ -1,7 +1,20 @@
 #version 330 core
+#ifdef STATIC
+// the base instance of a multi-draw and the buffer the packed objects' matrices live in
+#extension GL_ARB_shader_draw_parameters : require
+#extension GL_ARB_shader_storage_buffer_object : require
+#extension GL_ARB_shading_language_420pack : require
+#endif
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+#ifdef INSTANCED
+layout (location = 5) in mat4 aInstanceModel;
+#endif
+#ifdef STATIC
+// packed static geometry, the object's matrix at the draw's base instance
+layout (std430, binding = 1) readonly buffer StaticDraws { mat4 models[]; };
+#endif
 
 out vec2 TexCoords;
 out vec3 worldFragPos;
@@ -12,7 +25,14 @@ uniform mat4 projection;
 
 void main()
 {
-    worldFragPos = (model * vec4(aPos, 1.0)).xyz;
+#if defined(INSTANCED)
+    mat4 world = aInstanceModel;
+#elif defined(STATIC)
+    mat4 world = models[gl_BaseInstanceARB];
+#else
+    mat4 world = model;
+#endif
+    worldFragPos = (world * vec4(aPos, 1.0)).xyz;
     TexCoords = aTexCoords;    
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-}
\ No newline at end of file
+    gl_Position = projection * view * vec4(worldFragPos, 1.0);
+}
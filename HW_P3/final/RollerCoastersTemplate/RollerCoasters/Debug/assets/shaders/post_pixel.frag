@@ -0,0 +1,29 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D screenTexture;
+uniform float vx_offset = 0.5;
+uniform float screen_w;
+uniform float screen_h;
+uniform float pixel_w = 15;
+uniform float pixel_h = 10;
+
+void main()
+{
+    vec2 uv = TexCoords.xy;
+    vec3 tc = vec3(1.0, 0.0, 0.0);
+    if (uv.x < (vx_offset - 0.005))
+    {
+        float dx = pixel_w * (1. / screen_w);
+        float dy = pixel_h * (1. / screen_h);
+        vec2 coord = vec2(dx * floor(uv.x / dx), dy * floor(uv.y / dy));
+        tc = texture(screenTexture, coord).rgb;
+    }
+    else if (uv.x >= (vx_offset + 0.005))
+    {
+        tc = texture(screenTexture, uv).rgb;
+    }
+    FragColor = vec4(tc, 1.0);
+}
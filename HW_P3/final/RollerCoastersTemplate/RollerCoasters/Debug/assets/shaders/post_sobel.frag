@@ -0,0 +1,26 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D screenTexture;
+
+void main()
+{
+    vec4 horizEdge = vec4(0.0);
+    horizEdge -= textureOffset(screenTexture, TexCoords, ivec2(-1, -1)) * 1.0;
+    horizEdge -= textureOffset(screenTexture, TexCoords, ivec2(-1,  0)) * 2.0;
+    horizEdge -= textureOffset(screenTexture, TexCoords, ivec2(-1,  1)) * 1.0;
+    horizEdge += textureOffset(screenTexture, TexCoords, ivec2( 1, -1)) * 1.0;
+    horizEdge += textureOffset(screenTexture, TexCoords, ivec2( 1,  0)) * 2.0;
+    horizEdge += textureOffset(screenTexture, TexCoords, ivec2( 1,  1)) * 1.0;
+    vec4 vertEdge = vec4(0.0);
+    vertEdge -= textureOffset(screenTexture, TexCoords, ivec2(-1, -1)) * 1.0;
+    vertEdge -= textureOffset(screenTexture, TexCoords, ivec2( 0, -1)) * 2.0;
+    vertEdge -= textureOffset(screenTexture, TexCoords, ivec2( 1, -1)) * 1.0;
+    vertEdge += textureOffset(screenTexture, TexCoords, ivec2(-1,  1)) * 1.0;
+    vertEdge += textureOffset(screenTexture, TexCoords, ivec2( 0,  1)) * 2.0;
+    vertEdge += textureOffset(screenTexture, TexCoords, ivec2( 1,  1)) * 1.0;
+    vec3 edge = sqrt((horizEdge.rgb * horizEdge.rgb) + (vertEdge.rgb * vertEdge.rgb));
+    FragColor = vec4(edge, texture(screenTexture, TexCoords).a);
+}
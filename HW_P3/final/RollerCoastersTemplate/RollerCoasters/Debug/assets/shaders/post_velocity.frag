@@ -0,0 +1,26 @@
+#version 330 core
+out vec2 Velocity;
+
+in vec2 TexCoords;
+
+uniform sampler2D depthTexture;
+// the part of the depth target that was rendered into this frame
+uniform vec2 u_uv_scale = vec2(1.0);
+// previous view projection * inverse of the current one, takes this frame's ndc to where the point was last frame
+uniform mat4 u_reprojection;
+// in uv units, keeps camera cuts and the first frame from smearing the whole screen
+uniform float u_max_velocity = 0.05;
+
+void main()
+{
+    float depth = texture(depthTexture, TexCoords * u_uv_scale).r;
+    vec4 current = vec4(TexCoords * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+    vec4 previous = u_reprojection * current;
+    previous /= previous.w;
+
+    vec2 velocity = (current.xy - previous.xy) * 0.5;
+    float speed = length(velocity);
+    if (speed > u_max_velocity)
+        velocity *= u_max_velocity / speed;
+    Velocity = velocity;
+}
@@ -1,4 +1,10 @@
 #version 330 core
+#ifdef STATIC
+// the base instance of a multi-draw and the buffer the packed objects' matrices live in
+#extension GL_ARB_shader_draw_parameters : require
+#extension GL_ARB_shader_storage_buffer_object : require
+#extension GL_ARB_shading_language_420pack : require
+#endif
 
 // Input from vertex buffer
 layout (location = 0) in vec3 aPos;        // Vertex position
@@ -14,6 +20,11 @@ out vec3 Normal;
 out vec3 Tangent;
 out vec3 Bitangent;
 
+#ifdef STATIC
+// packed static geometry, the object's matrix at the draw's base instance
+layout (std430, binding = 1) readonly buffer StaticDraws { mat4 models[]; };
+#endif
+
 // Uniforms
 uniform mat4 model;       // Model matrix
 uniform mat4 view;        // View matrix
@@ -21,10 +32,15 @@ uniform mat4 projection;  // Projection matrix
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));      // World-space position
-    Normal = mat3(transpose(inverse(model))) * aNormal;  // Transform normal to world-space
-    Tangent = mat3(model) * aTangent;            // Transform tangent to world-space
-    Bitangent = mat3(model) * aBitangent;        // Transform bitangent to world-space
+#ifdef STATIC
+    mat4 world = models[gl_BaseInstanceARB];
+#else
+    mat4 world = model;
+#endif
+    FragPos = vec3(world * vec4(aPos, 1.0));      // World-space position
+    Normal = mat3(transpose(inverse(world))) * aNormal;  // Transform normal to world-space
+    Tangent = mat3(world) * aTangent;            // Transform tangent to world-space
+    Bitangent = mat3(world) * aBitangent;        // Transform bitangent to world-space
     TexCoords = aTexCoords;                      // Pass texture coordinates
 
     gl_Position = projection * view * vec4(FragPos, 1.0); // Clip-space position
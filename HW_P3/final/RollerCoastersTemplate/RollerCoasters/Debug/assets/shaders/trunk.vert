@@ -14,20 +14,27 @@ out vec3 fragPos;        // Pass world position
 out vec3 fragTangent;    // Pass tangent for TBN matrix
 
 // Uniforms
-uniform mat4 model;       // Model matrix
+uniform mat4 model;       // Places the whole tree
 uniform mat4 view;        // View matrix
 uniform mat4 projection;  // Projection matrix
 
+// One transform per branch, baked once per seed, drawn as one instance each
+layout(std430, binding = 0) readonly buffer Branches {
+    mat4 branches[];
+};
+
 void main() {
+    mat4 branch = model * branches[gl_InstanceID];
+
     // Calculate world position of the vertex
-    vec4 worldPosition = model * vec4(inPosition, 1.0);
+    vec4 worldPosition = branch * vec4(inPosition, 1.0);
     fragPos = worldPosition.xyz;
 
     // Transform the normal to world space
-    fragNormal = mat3(transpose(inverse(model))) * inNormal;
+    fragNormal = mat3(transpose(inverse(branch))) * inNormal;
 
     // Transform the tangent to world space
-    fragTangent = mat3(model) * inTangent;
+    fragTangent = mat3(branch) * inTangent;
 
     // Pass UV coordinates to the fragment shader
     fragUV = inUV;
@@ -0,0 +1,23 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D screenTexture;
+uniform sampler2D velocityTexture;
+uniform int u_samples = 8;
+// fraction of the frame the shutter stays open
+uniform float u_strength = 1.0;
+
+void main()
+{
+    // gather along the screen space motion of this pixel, centered on it
+    vec2 velocity = texture(velocityTexture, TexCoords).rg * u_strength;
+    vec3 sum = vec3(0.0);
+    for (int i = 0; i < u_samples; i++)
+    {
+        float t = (float(i) + 0.5) / float(u_samples) - 0.5;
+        sum += texture(screenTexture, TexCoords - velocity * t).rgb;
+    }
+    FragColor = vec4(sum / float(u_samples), 1.0);
+}
@@ -0,0 +1,14 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D screenTexture;
+uniform float t;
+
+void main()
+{
+    vec2 uv = TexCoords.xy;
+    vec3 col = texture(screenTexture, uv + 0.005 * vec2(sin(t + 1024.0 * uv.x), cos(t + 768.0 * uv.y))).xyz;
+    FragColor = vec4(col, 1.0);
+}
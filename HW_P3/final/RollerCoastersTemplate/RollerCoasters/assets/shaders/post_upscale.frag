@@ -0,0 +1,28 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D screenTexture;
+// texel size of the scene target
+uniform vec2 u_texelStep;
+// the part of the scene target that was rendered into this frame
+uniform vec2 u_uv_scale = vec2(1.0);
+uniform float u_sharpness = 0.5;
+
+vec3 tap(vec2 uv)
+{
+    // stay inside the rendered rectangle, the rest of the target is stale
+    return texture(screenTexture, clamp(uv, u_texelStep * 0.5, u_uv_scale - u_texelStep * 0.5)).rgb;
+}
+
+void main()
+{
+    vec2 uv = TexCoords * u_uv_scale;
+    vec3 center = tap(uv);
+    vec3 around = tap(uv + vec2(u_texelStep.x, 0.0)) + tap(uv - vec2(u_texelStep.x, 0.0))
+                + tap(uv + vec2(0.0, u_texelStep.y)) + tap(uv - vec2(0.0, u_texelStep.y));
+    // unsharp mask, gives back some of the edges the bilinear upscale smeared
+    vec3 sharpened = center + (center - around * 0.25) * u_sharpness;
+    FragColor = vec4(max(sharpened, vec3(0.0)), 1.0);
+}
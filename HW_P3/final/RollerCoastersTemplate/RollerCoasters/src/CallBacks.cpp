@@ -56,6 +56,24 @@ void damageCB(Fl_Widget*, TrainWindow* tw)
 	tw->damageMe();
 }
 
+//***************************************************************************
+//
+// * any number of post effects can be picked, "default" (line 1) means none
+//===========================================================================
+void postProcessCB(Fl_Widget*, TrainWindow* tw)
+{
+	Fl_Browser* list = tw->framebuffer;
+	bool any = false;
+	for (int i = 2; i <= list->size(); i++) {
+		// picking "default" clears the effects
+		if (list->value() == 1 && list->selected(1))
+			list->select(i, 0);
+		any = any || list->selected(i);
+	}
+	list->select(1, !any);
+	tw->damageMe();
+}
+
 //***************************************************************************
 //
 // * Callback that adds a new point to the spline
@@ -0,0 +1,154 @@
+#ifndef FRACTAL_TREE_H
+#define FRACTAL_TREE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <vector>
+#include <map>
+#include <future>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <algorithm>
+
+// the recursive tree baked into one buffer of branch transforms per seed.
+// a seed is grown once on a worker thread, uploaded to a shader storage buffer when it is done,
+// and from then on the whole tree is a single instanced draw of the trunk cylinder where the vertex shader
+// picks its branch with gl_InstanceID. trees with different seeds just keep their own buffers
+class FractalTree
+{
+public:
+    int levels = 7;
+    float length = 18.0f;       // of the trunk, each level is shrink times the one below it
+    float shrink = 0.8f;
+    glm::vec3 trunk_scale = glm::vec3(3.0f, 6.0f, 3.0f);
+    size_t max_trees = 16;      // baked seeds kept around, the least recently drawn go first
+
+    FractalTree() {}
+    FractalTree(const FractalTree&) = delete;
+    FractalTree& operator=(const FractalTree&) = delete;
+    ~FractalTree()
+    {
+        // a future from std::async waits for its thread when destroyed, so nothing outlives us
+        for (auto& tree : trees)
+            if (tree.second.ssbo)
+                glDeleteBuffers(1, &tree.second.ssbo);
+    }
+
+    // starts growing the tree for seed in the background, nothing happens if it is baked or on its way
+    void request(int seed)
+    {
+        Baked& tree = trees[seed];
+        tree.last_used = clock;
+        if (tree.ssbo || tree.pending.valid())
+            return;
+        int _levels = levels;
+        float _length = length, _shrink = shrink;
+        glm::vec3 scale = trunk_scale;
+        tree.pending = std::async(std::launch::async, [=]() {
+            std::vector<glm::mat4> branches;
+            branches.reserve(((size_t)std::pow(3.0, _levels) - 1) / 2);
+            grow(branches, _length, _levels, _shrink, glm::vec3(0.0f), scale, glm::vec3(0.0f), seed);
+            return branches;
+        });
+        evict();
+    }
+
+    // true once seed can be drawn, the first call that finds the worker done uploads its branches
+    bool ready(int seed)
+    {
+        auto it = trees.find(seed);
+        if (it == trees.end())
+            return false;
+        Baked& tree = it->second;
+        if (!tree.ssbo && tree.pending.valid() && tree.pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            std::vector<glm::mat4> branches = tree.pending.get();
+            glGenBuffers(1, &tree.ssbo);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, tree.ssbo);
+            glBufferStorage(GL_SHADER_STORAGE_BUFFER, branches.size() * sizeof(glm::mat4), branches.data(), 0);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+            tree.count = (GLsizei)branches.size();
+        }
+        return tree.ssbo != 0;
+    }
+
+    // binds the branches of a ready seed to the storage buffer binding and returns how many instances to draw
+    GLsizei bind(int seed, GLuint binding)
+    {
+        if (!ready(seed))
+            return 0;
+        Baked& tree = trees[seed];
+        tree.last_used = ++clock;
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, tree.ssbo);
+        return tree.count;
+    }
+
+    // a box in tree space every seed fits in, the branches together are never longer than this in any direction
+    void bounds(glm::vec3& low, glm::vec3& high) const
+    {
+        float reach = length * (1.0f - std::pow(shrink, (float)levels)) / (1.0f - shrink) + (std::max)(trunk_scale.x, trunk_scale.z);
+        low = glm::vec3(-reach);
+        high = glm::vec3(reach);
+    }
+
+    // the branch transforms in tree space, each one scales, turns and moves the unit cylinder along y
+    static void grow(std::vector<glm::mat4>& branches, float length, int level, float shrink,
+        glm::vec3 position, glm::vec3 scale, glm::vec3 rotation, int seed)
+    {
+        if (level <= 0 || length <= 0)
+            return;
+
+        glm::mat4 rotate = glm::rotate(glm::mat4(1.0f), glm::radians(rotation.x), glm::vec3(1, 0, 0));
+        rotate = glm::rotate(rotate, glm::radians(rotation.y), glm::vec3(0, 1, 0));
+        rotate = glm::rotate(rotate, glm::radians(rotation.z), glm::vec3(0, 0, 1));
+        branches.push_back(glm::translate(glm::mat4(1.0f), position) * rotate * glm::scale(glm::mat4(1.0f), scale));
+
+        // the children start at the tip of this branch
+        glm::vec3 tip = position + glm::vec3(rotate * glm::vec4(0.0f, length, 0.0f, 0.0f));
+        length *= shrink;
+        scale *= shrink;
+
+        // a generator per branch instead of rand(), which is shared with everything else and not safe off the main thread
+        const int children = 3;
+        std::minstd_rand incline_random(seed++);
+        float incline = (float)(incline_random() % 21 + 30);
+        for (int i = 0; i < children; i++) {
+            std::minstd_rand random(seed++);
+            glm::vec3 child = rotation;
+            // lean over along z, then spread around y with -10~10 degrees of noise
+            child.z -= incline / (children - 1);
+            child.y += 360.0f / children * i + (float)(random() % 21) - 10.0f;
+            grow(branches, length, level - 1, shrink, tip, scale, child, seed);
+        }
+    }
+
+private:
+    struct Baked
+    {
+        GLuint ssbo = 0;
+        GLsizei count = 0;
+        int last_used = 0;
+        std::future<std::vector<glm::mat4>> pending;
+    };
+
+    // drops the least recently drawn baked trees over max_trees, trees still growing are left alone
+    void evict()
+    {
+        while (trees.size() > max_trees) {
+            auto oldest = trees.end();
+            for (auto it = trees.begin(); it != trees.end(); ++it)
+                if (it->second.ssbo && (oldest == trees.end() || it->second.last_used < oldest->second.last_used))
+                    oldest = it;
+            if (oldest == trees.end())
+                return;
+            glDeleteBuffers(1, &oldest->second.ssbo);
+            trees.erase(oldest);
+        }
+    }
+
+    int clock = 0;
+    std::map<int, Baked> trees;
+};
+#endif
@@ -0,0 +1,234 @@
+#ifndef IMPOSTOR_H
+#define IMPOSTOR_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "model.h"
+#include "RenderUtilities/GLState.h"
+
+#include <vector>
+#include <cmath>
+#include <iostream>
+
+// a model baked into an atlas of views and drawn as one camera facing quad.
+// the views are taken from FRAMES x FRAMES directions over the upper half of a hemi-octahedron, so they are spread
+// evenly from the horizon to straight above. the quad samples the four baked views around the direction it is seen from
+// and blends them, and writes the depth the baked surface had instead of the quad's, so impostors sit in the ground right.
+// the second atlas keeps the model space normal next to that depth, for props that are lit
+class Impostor
+{
+public:
+    static const int FRAMES = 8;            // views per side of the atlas
+    static const int FRAME_SIZE = 128;      // texels per side of a view
+
+    GLuint albedo = 0;                      // rgb and coverage
+    GLuint normal_depth = 0;                // model space normal in rgb, depth toward the viewer in a
+    glm::vec3 center;                       // of the sphere the views were taken around, in model space
+    float radius;
+
+    // model is baked with bake_shader (impostor_bake), texture is its texture1 for all the meshes
+    Impostor(const Model& _model, Shader* _bake_shader, GLuint _texture) : model(_model), bake_shader(_bake_shader), texture(_texture)
+    {
+        center = (model.low + model.high) * 0.5f;
+        radius = glm::length(model.high - model.low) * 0.5f;
+    }
+    Impostor(const Impostor&) = delete;
+    Impostor& operator=(const Impostor&) = delete;
+    ~Impostor()
+    {
+        glDeleteTextures(1, &albedo);
+        glDeleteTextures(1, &normal_depth);
+        if (instances.buffer)
+            glDeleteBuffers(1, &instances.buffer);
+        if (quad_vao) {
+            glDeleteBuffers(1, &quad_vbo);
+            glDeleteBuffers(1, &quad_ebo);
+            glDeleteVertexArrays(1, &quad_vao);
+        }
+        GLState::invalidate();
+    }
+
+    // renders every view into the atlases, once bake_shader is linked and before anything is drawn
+    void bake()
+    {
+        static const Shader::Handle u_projection = Shader::handle("projection");
+        static const Shader::Handle u_view = Shader::handle("view");
+        static const Shader::Handle u_model = Shader::handle("model");
+        static const Shader::Handle u_texture1 = Shader::handle("texture1");
+        static const Shader::Handle u_impostor_center = Shader::handle("impostor_center");
+        static const Shader::Handle u_impostor_radius = Shader::handle("impostor_radius");
+        static const Shader::Handle u_impostor_direction = Shader::handle("impostor_direction");
+
+        int size = FRAMES * FRAME_SIZE;
+        albedo = atlas(GL_RGBA8, size);
+        normal_depth = atlas(GL_RGBA16F, size);
+        GLuint fbo, depth;
+        glGenFramebuffers(1, &fbo);
+        glGenRenderbuffers(1, &depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size, size);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        GLint previous_fbo, viewport[4];
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous_fbo);
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        GLState::bind_framebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedo, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normal_depth, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+        GLenum buffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, buffers);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::IMPOSTOR::FRAMEBUFFER_INCOMPLETE" << std::endl;
+
+        // nothing is where the model isn't: no coverage, and the depth of the plane through the center
+        GLfloat clear_albedo[] = { 0.0f, 0.0f, 0.0f, 0.0f }, clear_normal_depth[] = { 0.5f, 1.0f, 0.5f, 0.5f }, clear_depth = 1.0f;
+        glClearBufferfv(GL_COLOR, 0, clear_albedo);
+        glClearBufferfv(GL_COLOR, 1, clear_normal_depth);
+        glClearBufferfv(GL_DEPTH, 0, &clear_depth);
+        GLState::enable(GL_DEPTH_TEST);
+        GLState::depth_func(GL_LESS);
+        GLState::depth_mask(GL_TRUE);
+        GLState::disable(GL_CULL_FACE);
+        GLState::disable(GL_BLEND);
+
+        bake_shader->Use();
+        GLState::bind_texture(GL_TEXTURE0, GL_TEXTURE_2D, texture);
+        glm::mat4 identity(1.0f);
+        bake_shader->setMat4(u_model, glm::value_ptr(identity));
+        bake_shader->setInt(u_texture1, 0);
+        bake_shader->setVec3(u_impostor_center, center.x, center.y, center.z);
+        bake_shader->setFloat(u_impostor_radius, radius);
+        // orthographic, the sphere just fits the view
+        glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, 0.5f * radius, 3.5f * radius);
+        bake_shader->setMat4(u_projection, glm::value_ptr(projection));
+        for (int y = 0; y < FRAMES; y++) {
+            for (int x = 0; x < FRAMES; x++) {
+                glm::vec3 d = direction(x, y);
+                // straight down the up vector has to change, impostor.vert picks the same one
+                glm::vec3 up = std::abs(d.y) > 0.999f ? glm::vec3(0.0f, 0.0f, -1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+                glm::mat4 view = glm::lookAt(center + d * 2.0f * radius, center, up);
+                bake_shader->setMat4(u_view, glm::value_ptr(view));
+                bake_shader->setVec3(u_impostor_direction, d.x, d.y, d.z);
+                glViewport(x * FRAME_SIZE, y * FRAME_SIZE, FRAME_SIZE, FRAME_SIZE);
+                // like StaticGeometry, the one texture goes for every mesh and their own are not bound
+                for (const Mesh& mesh : model.meshes) {
+                    GLState::bind_vertex_array(mesh.VAO);
+                    glDrawElements(GL_TRIANGLES, (GLsizei)mesh.indices.size(), GL_UNSIGNED_INT, 0);
+                }
+            }
+        }
+
+        GLState::bind_framebuffer(GL_FRAMEBUFFER, previous_fbo);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        glDeleteRenderbuffers(1, &depth);
+        glDeleteFramebuffers(1, &fbo);
+        GLState::invalidate();
+        GLState::use_program(0);
+
+        // mipmapped, far impostors are a few pixels big
+        GLState::bind_texture(GL_TEXTURE0, GL_TEXTURE_2D, albedo);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        GLState::bind_texture(GL_TEXTURE_2D, normal_depth);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        GLState::bind_texture(GL_TEXTURE_2D, 0);
+    }
+
+    // sets the impostor's uniforms and textures on shader (impostor) and binds the quad's VAO,
+    // the caller attaches instances and draws 6 indices per impostor. projection, view and cameraPos are the caller's
+    void bind(Shader* shader)
+    {
+        static const Shader::Handle u_impostor_center = Shader::handle("impostor_center");
+        static const Shader::Handle u_impostor_radius = Shader::handle("impostor_radius");
+        static const Shader::Handle u_impostor_frames = Shader::handle("impostor_frames");
+        static const Shader::Handle u_impostor_albedo = Shader::handle("impostor_albedo");
+        static const Shader::Handle u_impostor_normal_depth = Shader::handle("impostor_normal_depth");
+
+        if (!quad_vao)
+            setup_quad();
+        shader->setVec3(u_impostor_center, center.x, center.y, center.z);
+        shader->setFloat(u_impostor_radius, radius);
+        shader->setInt(u_impostor_frames, FRAMES);
+        shader->setInt(u_impostor_albedo, 0);
+        shader->setInt(u_impostor_normal_depth, 1);
+        GLState::bind_texture(GL_TEXTURE0, GL_TEXTURE_2D, albedo);
+        GLState::bind_texture(GL_TEXTURE1, GL_TEXTURE_2D, normal_depth);
+        GLState::active_texture(GL_TEXTURE0);
+        GLState::bind_vertex_array(quad_vao);
+    }
+
+    // adds a copy at world to this frame's draw()
+    void queue(const glm::mat4& world)
+    {
+        Instance instance;
+        instance.Transform = world;
+        queued.push_back(instance);
+    }
+
+    // everything queued, in one instanced call with the current program. the queue is empty afterwards
+    void draw(Shader* shader)
+    {
+        if (queued.empty())
+            return;
+        instances.upload(queued);
+        bind(shader);
+        instances.bind();
+        glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, instances.count);
+        queued.clear();
+    }
+
+    // the view the atlas holds at frame (x, y), the same mapping impostor.vert uses
+    static glm::vec3 direction(int x, int y)
+    {
+        glm::vec2 p = glm::vec2(x, y) / (float)(FRAMES - 1) * 2.0f - 1.0f;
+        glm::vec2 t = glm::vec2(p.x + p.y, p.x - p.y) * 0.5f;
+        return glm::normalize(glm::vec3(t.x, 1.0f - std::abs(t.x) - std::abs(t.y), t.y));
+    }
+
+private:
+    const Model& model;
+    Shader* bake_shader;
+    GLuint texture;
+    std::vector<Instance> queued;
+    InstanceBuffer instances;
+    GLuint quad_vao = 0, quad_vbo = 0, quad_ebo = 0;
+
+    static GLuint atlas(GLenum format, int size)
+    {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        GLState::bind_texture(GL_TEXTURE0, GL_TEXTURE_2D, texture);
+        int levels = 1;
+        while ((size >> levels) >= FRAMES)
+            levels++;
+        glTexStorage2D(GL_TEXTURE_2D, levels, format, size, size);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return texture;
+    }
+
+    // a unit quad in the xy plane, the vertex shader turns it to the camera
+    void setup_quad()
+    {
+        float corners[] = { -1.0f, -1.0f,  1.0f, -1.0f,  1.0f, 1.0f,  -1.0f, 1.0f };
+        unsigned int indices[] = { 0, 1, 2, 0, 2, 3 };
+        glGenVertexArrays(1, &quad_vao);
+        glGenBuffers(1, &quad_vbo);
+        glGenBuffers(1, &quad_ebo);
+        GLState::bind_vertex_array(quad_vao);
+        glBindBuffer(GL_ARRAY_BUFFER, quad_vbo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, quad_ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+        setupInstanceAttributes();
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+};
+#endif
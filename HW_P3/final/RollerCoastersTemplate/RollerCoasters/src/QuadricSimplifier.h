@@ -0,0 +1,344 @@
+#ifndef QUADRIC_SIMPLIFIER_H
+#define QUADRIC_SIMPLIFIER_H
+
+#include <glm/glm.hpp>
+
+#include "mesh.h"
+
+#include <vector>
+#include <array>
+#include <queue>
+#include <unordered_map>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+// Garland/Heckbert edge collapse. every vertex keeps the sum of the squared distances to the planes of its triangles,
+// and the edge whose collapse adds the least to that error goes first, until only the target number of triangles is left.
+// an edge always collapses onto one of its ends, so the result is a new index buffer over the vertices the mesh already has
+// and every level of detail can share the same vertex buffer.
+// the copies of a point with different uvs or normals (a seam) are kept apart: a corner of the point that goes away takes
+// the copy of the point it lands on with the same attributes, and collapses that would tear a seam open are skipped
+class QuadricSimplifier
+{
+public:
+    // open borders weigh this much more than the surfaces, so holes and outlines don't shrink away first
+    static constexpr double BORDER_WEIGHT = 100.0;
+
+    // indices for about target triangles, made of the given vertices. fewer go when the rest would tear a seam
+    static std::vector<unsigned int> simplify(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, size_t target)
+    {
+        size_t triangle_count = indices.size() / 3;
+        if (triangle_count <= target || vertices.empty())
+            return indices;
+
+        // the copies of a vertex an OBJ splits for its normals or uvs are one point that moves as a whole
+        std::vector<unsigned int> point(vertices.size());
+        std::vector<unsigned int> representative;
+        std::unordered_map<PositionKey, unsigned int, PositionHash> seen;
+        for (size_t i = 0; i < vertices.size(); i++) {
+            auto it = seen.find(PositionKey(vertices[i].Position));
+            if (it == seen.end()) {
+                it = seen.insert({ PositionKey(vertices[i].Position), (unsigned int)representative.size() }).first;
+                representative.push_back((unsigned int)i);
+            }
+            point[i] = it->second;
+        }
+        size_t points = representative.size();
+
+        // the copies with the same uv and normal as well are interchangeable, one of them stands for all
+        std::vector<unsigned int> wedge(vertices.size());
+        std::unordered_map<WedgeKey, unsigned int, WedgeHash> same;
+        for (size_t i = 0; i < vertices.size(); i++)
+            wedge[i] = same.insert({ WedgeKey(vertices[i]), (unsigned int)i }).first->second;
+        auto position = [&](unsigned int p) -> glm::dvec3 { return glm::dvec3(vertices[representative[p]].Position); };
+
+        std::vector<Quadric> quadrics(points);
+        std::vector<std::array<unsigned int, 3>> triangles(triangle_count), corners(triangle_count);
+        std::vector<bool> removed(triangle_count, false);
+        std::vector<std::vector<unsigned int>> around(points);
+        std::unordered_map<uint64_t, int> edges;
+        size_t live = 0;
+        for (size_t t = 0; t < triangle_count; t++) {
+            for (int k = 0; k < 3; k++) {
+                corners[t][k] = wedge[indices[t * 3 + k]];
+                triangles[t][k] = point[corners[t][k]];
+            }
+            const std::array<unsigned int, 3>& p = triangles[t];
+            if (p[0] == p[1] || p[1] == p[2] || p[0] == p[2]) {
+                removed[t] = true;
+                continue;
+            }
+            glm::dvec3 a = position(p[0]), b = position(p[1]), c = position(p[2]);
+            glm::dvec3 n = glm::cross(b - a, c - a);
+            double area = glm::length(n);
+            if (area > 0.0) {
+                n /= area;
+                Quadric q = Quadric::plane(n, -glm::dot(n, a), area * 0.5);
+                for (int k = 0; k < 3; k++)
+                    quadrics[p[k]] += q;
+            }
+            for (int k = 0; k < 3; k++) {
+                around[p[k]].push_back((unsigned int)t);
+                edges[key(p[k], p[(k + 1) % 3])]++;
+            }
+            live++;
+        }
+
+        // a plane through every border edge, standing on its triangle
+        for (size_t t = 0; t < triangle_count; t++) {
+            if (removed[t])
+                continue;
+            const std::array<unsigned int, 3>& p = triangles[t];
+            glm::dvec3 n = glm::cross(position(p[1]) - position(p[0]), position(p[2]) - position(p[0]));
+            if (glm::length(n) == 0.0)
+                continue;
+            n = glm::normalize(n);
+            for (int k = 0; k < 3; k++) {
+                unsigned int u = p[k], v = p[(k + 1) % 3];
+                if (edges[key(u, v)] != 1)
+                    continue;
+                glm::dvec3 edge = position(v) - position(u);
+                glm::dvec3 m = glm::cross(edge, n);
+                if (glm::length(m) == 0.0)
+                    continue;
+                m = glm::normalize(m);
+                Quadric q = Quadric::plane(m, -glm::dot(m, position(u)), BORDER_WEIGHT * glm::dot(edge, edge));
+                quadrics[u] += q;
+                quadrics[v] += q;
+            }
+        }
+
+        std::vector<unsigned int> version(points, 0);
+        std::vector<bool> gone(points, false);
+        std::vector<std::pair<unsigned int, unsigned int>> onto;
+        std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> heap;
+        auto consider = [&](unsigned int u, unsigned int v) {
+            Quadric q = quadrics[u];
+            q += quadrics[v];
+            double onto_v = q.error(position(v)), onto_u = q.error(position(u));
+            if (onto_v <= onto_u)
+                heap.push({ onto_v, u, v, version[u], version[v] });
+            else
+                heap.push({ onto_u, v, u, version[v], version[u] });
+        };
+        for (size_t t = 0; t < triangle_count; t++)
+            if (!removed[t])
+                for (int k = 0; k < 3; k++)
+                    if (triangles[t][k] < triangles[t][(k + 1) % 3])
+                        consider(triangles[t][k], triangles[t][(k + 1) % 3]);
+
+        while (live > target && !heap.empty()) {
+            Candidate c = heap.top();
+            heap.pop();
+            if (gone[c.from] || gone[c.to] || version[c.from] != c.from_version || version[c.to] != c.to_version)
+                continue;
+            if (flips(triangles, removed, around[c.from], c.from, c.to, position))
+                continue;
+            if (!pair(triangles, corners, removed, around[c.from], c.from, c.to, onto))
+                continue;
+
+            // from is now to, the triangles on the edge disappear
+            gone[c.from] = true;
+            quadrics[c.to] += quadrics[c.from];
+            for (unsigned int t : around[c.from]) {
+                if (removed[t])
+                    continue;
+                for (int k = 0; k < 3; k++)
+                    if (triangles[t][k] == c.from) {
+                        triangles[t][k] = c.to;
+                        for (const std::pair<unsigned int, unsigned int>& o : onto)
+                            if (o.first == corners[t][k]) {
+                                corners[t][k] = o.second;
+                                break;
+                            }
+                    }
+                const std::array<unsigned int, 3>& p = triangles[t];
+                if (p[0] == p[1] || p[1] == p[2] || p[0] == p[2]) {
+                    removed[t] = true;
+                    live--;
+                }
+                else
+                    around[c.to].push_back(t);
+            }
+            std::vector<unsigned int>().swap(around[c.from]);
+            version[c.to]++;
+
+            // the edges around to changed their cost, dead triangles are dropped on the way
+            std::vector<unsigned int>& ring = around[c.to];
+            size_t kept = 0;
+            for (unsigned int t : ring) {
+                if (removed[t])
+                    continue;
+                ring[kept++] = t;
+                for (int k = 0; k < 3; k++)
+                    if (triangles[t][k] != c.to)
+                        consider(c.to, triangles[t][k]);
+            }
+            ring.resize(kept);
+        }
+
+        std::vector<unsigned int> result;
+        result.reserve(live * 3);
+        for (size_t t = 0; t < triangle_count; t++)
+            if (!removed[t])
+                result.insert(result.end(), corners[t].begin(), corners[t].end());
+        return result;
+    }
+
+private:
+    // symmetric 4x4 matrix, the upper triangle row by row
+    struct Quadric
+    {
+        double m[10] = { 0 };
+
+        static Quadric plane(const glm::dvec3& n, double d, double weight)
+        {
+            Quadric q;
+            double p[4] = { n.x, n.y, n.z, d };
+            int i = 0;
+            for (int r = 0; r < 4; r++)
+                for (int c = r; c < 4; c++)
+                    q.m[i++] = p[r] * p[c] * weight;
+            return q;
+        }
+
+        Quadric& operator+=(const Quadric& o)
+        {
+            for (int i = 0; i < 10; i++)
+                m[i] += o.m[i];
+            return *this;
+        }
+
+        double error(const glm::dvec3& v) const
+        {
+            return m[0] * v.x * v.x + 2 * m[1] * v.x * v.y + 2 * m[2] * v.x * v.z + 2 * m[3] * v.x
+                + m[4] * v.y * v.y + 2 * m[5] * v.y * v.z + 2 * m[6] * v.y
+                + m[7] * v.z * v.z + 2 * m[8] * v.z
+                + m[9];
+        }
+    };
+
+    struct Candidate
+    {
+        double cost;
+        unsigned int from, to;
+        unsigned int from_version, to_version;
+
+        bool operator>(const Candidate& o) const { return cost > o.cost; }
+    };
+
+    struct PositionKey
+    {
+        float x, y, z;
+        PositionKey(const glm::vec3& p) : x(p.x), y(p.y), z(p.z) {}
+        bool operator==(const PositionKey& o) const { return x == o.x && y == o.y && z == o.z; }
+    };
+
+    struct PositionHash
+    {
+        size_t operator()(const PositionKey& k) const
+        {
+            uint32_t b[3];
+            std::memcpy(b, &k, sizeof(b));
+            return ((size_t)b[0] * 73856093u) ^ ((size_t)b[1] * 19349663u) ^ ((size_t)b[2] * 83492791u);
+        }
+    };
+
+    // position, normal and uv, what makes two copies of a point the same vertex as far as the result is concerned
+    struct WedgeKey
+    {
+        float v[8];
+        WedgeKey(const Vertex& vertex)
+        {
+            std::memcpy(v, &vertex.Position, sizeof(float) * 3);
+            std::memcpy(v + 3, &vertex.Normal, sizeof(float) * 3);
+            std::memcpy(v + 6, &vertex.TexCoords, sizeof(float) * 2);
+        }
+        // bitwise, like the hash
+        bool operator==(const WedgeKey& o) const { return std::memcmp(v, o.v, sizeof(v)) == 0; }
+    };
+
+    struct WedgeHash
+    {
+        size_t operator()(const WedgeKey& k) const
+        {
+            uint32_t b[8];
+            std::memcpy(b, k.v, sizeof(b));
+            size_t h = 0;
+            for (int i = 0; i < 8; i++)
+                h = h * 31 + b[i];
+            return h;
+        }
+    };
+
+    static uint64_t key(unsigned int u, unsigned int v)
+    {
+        if (u > v)
+            std::swap(u, v);
+        return (uint64_t)u << 32 | v;
+    }
+
+    // which copy of to every copy of from around it becomes: the one next to it in the triangles on the edge.
+    // false when a copy of from has no triangle on the edge, it is on the other side of a seam that the edge leaves,
+    // or when it meets two different copies of to, then the seam only runs through one end of the edge.
+    // either way the collapse would stretch one side's uvs over the other
+    static bool pair(const std::vector<std::array<unsigned int, 3>>& triangles, const std::vector<std::array<unsigned int, 3>>& corners,
+        const std::vector<bool>& removed, const std::vector<unsigned int>& ring, unsigned int from, unsigned int to,
+        std::vector<std::pair<unsigned int, unsigned int>>& onto)
+    {
+        onto.clear();
+        for (unsigned int t : ring) {
+            if (removed[t])
+                continue;
+            int f = -1, k = -1;
+            for (int i = 0; i < 3; i++) {
+                if (triangles[t][i] == from)
+                    f = i;
+                if (triangles[t][i] == to)
+                    k = i;
+            }
+            if (f < 0 || k < 0)
+                continue;
+            auto it = std::find_if(onto.begin(), onto.end(), [&](const std::pair<unsigned int, unsigned int>& o) { return o.first == corners[t][f]; });
+            if (it == onto.end())
+                onto.push_back({ corners[t][f], corners[t][k] });
+            else if (it->second != corners[t][k])
+                return false;
+        }
+        for (unsigned int t : ring) {
+            if (removed[t])
+                continue;
+            for (int i = 0; i < 3; i++)
+                if (triangles[t][i] == from && std::find_if(onto.begin(), onto.end(),
+                    [&](const std::pair<unsigned int, unsigned int>& o) { return o.first == corners[t][i]; }) == onto.end())
+                    return false;
+        }
+        return true;
+    }
+
+    // whether moving from onto to turns one of the triangles that stay over, or squashes it flat
+    template <class Position>
+    static bool flips(const std::vector<std::array<unsigned int, 3>>& triangles, const std::vector<bool>& removed,
+        const std::vector<unsigned int>& ring, unsigned int from, unsigned int to, Position position)
+    {
+        for (unsigned int t : ring) {
+            if (removed[t])
+                continue;
+            const std::array<unsigned int, 3>& p = triangles[t];
+            if (p[0] == to || p[1] == to || p[2] == to)
+                continue;
+            glm::dvec3 before[3], after[3];
+            for (int k = 0; k < 3; k++) {
+                before[k] = position(p[k]);
+                after[k] = p[k] == from ? position(to) : before[k];
+            }
+            glm::dvec3 n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+            glm::dvec3 n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+            if (glm::dot(n0, n1) <= 0.2 * glm::length(n0) * glm::length(n1))
+                return true;
+        }
+        return false;
+    }
+};
+#endif
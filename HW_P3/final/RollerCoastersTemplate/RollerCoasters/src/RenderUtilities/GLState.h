@@ -0,0 +1,204 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#include <map>
+
+// a shadow copy of the state the renderer keeps switching: the program, the vertex array, the textures of every unit,
+// the framebuffers and the enable/blend/depth switches. a call that wouldn't change anything is not made, only counted.
+// it only knows what went through it, so code that changes the same state behind its back
+// (the fixed-function helpers in 3DUtils, FlTk) has to be followed by invalidate()
+class GLState
+{
+public:
+	static const int UNITS = 32;
+
+	// the calls made and skipped during the last frame
+	static int issued() { return state().last_issued; }
+	static int avoided() { return state().last_avoided; }
+
+	// call once at the start of every frame, what happened in between is unknown
+	static void frame()
+	{
+		State& s = state();
+		s.last_issued = s.issued;
+		s.last_avoided = s.avoided;
+		s.issued = s.avoided = 0;
+		invalidate();
+	}
+
+	// forgets everything, the next call of every kind goes through.
+	// also needed after deleting a bound object, its name can come back for a new one
+	static void invalidate()
+	{
+		State& s = state();
+		s.program = s.vertex_array = s.read_framebuffer = s.draw_framebuffer = UNKNOWN;
+		s.active_texture = UNKNOWN;
+		for (int i = 0; i < UNITS; i++)
+			s.textures_2d[i] = s.textures_cube[i] = UNKNOWN;
+		s.caps.clear();
+		s.blend_src = s.blend_dst = s.depth_func = UNKNOWN;
+		s.depth_mask = -1;
+	}
+
+	static void use_program(GLuint program)
+	{
+		State& s = state();
+		if (change(s.program, program))
+			glUseProgram(program);
+	}
+
+	static void bind_vertex_array(GLuint vertex_array)
+	{
+		State& s = state();
+		if (change(s.vertex_array, vertex_array))
+			glBindVertexArray(vertex_array);
+	}
+
+	// unit is GL_TEXTURE0 + i like glActiveTexture's
+	static void active_texture(GLenum unit)
+	{
+		State& s = state();
+		if (change(s.active_texture, unit))
+			glActiveTexture(unit);
+	}
+
+	// on the active unit, only 2D and cube map bindings are remembered
+	static void bind_texture(GLenum target, GLuint texture)
+	{
+		State& s = state();
+		GLuint* slot = nullptr;
+		int unit = s.active_texture == UNKNOWN ? -1 : (int)(s.active_texture - GL_TEXTURE0);
+		if (unit >= 0 && unit < UNITS) {
+			if (target == GL_TEXTURE_2D)
+				slot = &s.textures_2d[unit];
+			else if (target == GL_TEXTURE_CUBE_MAP)
+				slot = &s.textures_cube[unit];
+		}
+		if (!slot) {
+			s.issued++;
+			glBindTexture(target, texture);
+		}
+		else if (change(*slot, texture))
+			glBindTexture(target, texture);
+	}
+
+	// texture on unit, leaving unit active
+	static void bind_texture(GLenum unit, GLenum target, GLuint texture)
+	{
+		active_texture(unit);
+		bind_texture(target, texture);
+	}
+
+	// GL_FRAMEBUFFER binds both the read and the draw framebuffer
+	static void bind_framebuffer(GLenum target, GLuint framebuffer)
+	{
+		State& s = state();
+		if (target == GL_FRAMEBUFFER) {
+			if (s.read_framebuffer == framebuffer && s.draw_framebuffer == framebuffer) {
+				s.avoided++;
+				return;
+			}
+			s.issued++;
+			s.read_framebuffer = s.draw_framebuffer = framebuffer;
+			glBindFramebuffer(target, framebuffer);
+		}
+		else if (change(target == GL_READ_FRAMEBUFFER ? s.read_framebuffer : s.draw_framebuffer, framebuffer))
+			glBindFramebuffer(target, framebuffer);
+	}
+
+	static void enable(GLenum cap) { set(cap, true); }
+	static void disable(GLenum cap) { set(cap, false); }
+
+	static void set(GLenum cap, bool on)
+	{
+		State& s = state();
+		auto it = s.caps.find(cap);
+		if (it != s.caps.end() && it->second == on) {
+			s.avoided++;
+			return;
+		}
+		s.issued++;
+		s.caps[cap] = on;
+		if (on)
+			glEnable(cap);
+		else
+			glDisable(cap);
+	}
+
+	static void blend_func(GLenum src, GLenum dst)
+	{
+		State& s = state();
+		if (s.blend_src == src && s.blend_dst == dst) {
+			s.avoided++;
+			return;
+		}
+		s.issued++;
+		s.blend_src = src;
+		s.blend_dst = dst;
+		glBlendFunc(src, dst);
+	}
+
+	static void depth_func(GLenum func)
+	{
+		State& s = state();
+		if (change(s.depth_func, func))
+			glDepthFunc(func);
+	}
+
+	static void depth_mask(GLboolean on)
+	{
+		State& s = state();
+		if (s.depth_mask == (int)on) {
+			s.avoided++;
+			return;
+		}
+		s.issued++;
+		s.depth_mask = on;
+		glDepthMask(on);
+	}
+
+private:
+	static const GLuint UNKNOWN = 0xffffffff;
+
+	struct State
+	{
+		GLuint program = UNKNOWN, vertex_array = UNKNOWN;
+		GLuint read_framebuffer = UNKNOWN, draw_framebuffer = UNKNOWN;
+		GLenum active_texture = UNKNOWN;
+		GLuint textures_2d[UNITS], textures_cube[UNITS];
+		std::map<GLenum, bool> caps;
+		GLenum blend_src = UNKNOWN, blend_dst = UNKNOWN, depth_func = UNKNOWN;
+		int depth_mask = -1;
+		int issued = 0, avoided = 0;
+		int last_issued = 0, last_avoided = 0;
+
+		State()
+		{
+			for (int i = 0; i < UNITS; i++)
+				textures_2d[i] = textures_cube[i] = UNKNOWN;
+		}
+	};
+
+	// there is only the one context
+	static State& state()
+	{
+		static State s;
+		return s;
+	}
+
+	// true and counted as issued when value really changes
+	static bool change(GLuint& current, GLuint value)
+	{
+		State& s = state();
+		if (current == value) {
+			s.avoided++;
+			return false;
+		}
+		s.issued++;
+		current = value;
+		return true;
+	}
+};
+#endif
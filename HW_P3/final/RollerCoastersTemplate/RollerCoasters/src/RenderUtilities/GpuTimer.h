@@ -0,0 +1,59 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+#include <vector>
+
+// measures how long the GPU spends between begin() and end() with GL_TIME_ELAPSED queries.
+// the result of a frame is read a few frames later, when the query has surely finished,
+// so asking for the time never stalls the pipeline
+class GpuTimer
+{
+public:
+	GpuTimer(int _frames = 4) : frames(_frames), queries(_frames), issued(_frames, false)
+	{
+		glGenQueries(this->frames, this->queries.data());
+	}
+	GpuTimer(const GpuTimer&) = delete;
+	GpuTimer& operator=(const GpuTimer&) = delete;
+	~GpuTimer()
+	{
+		glDeleteQueries(this->frames, this->queries.data());
+	}
+
+	void begin()
+	{
+		glBeginQuery(GL_TIME_ELAPSED, this->queries[this->current]);
+	}
+
+	void end()
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		this->issued[this->current] = true;
+		this->current = (this->current + 1) % this->frames;
+
+		// the slot begin() reuses next is the oldest one, collect it first
+		if (this->issued[this->current]) {
+			GLint available = 0;
+			glGetQueryObjectiv(this->queries[this->current], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (available) {
+				GLuint64 ns = 0;
+				glGetQueryObjectui64v(this->queries[this->current], GL_QUERY_RESULT, &ns);
+				this->ms = ns / 1000000.0f;
+			}
+			this->issued[this->current] = false;
+		}
+	}
+
+	// the most recent finished measurement, negative until the first one arrives
+	float milliseconds() const { return this->ms; }
+
+private:
+	int frames;
+	int current = 0;
+	float ms = -1.0f;
+	std::vector<GLuint> queries;
+	std::vector<bool> issued;
+};
+#endif
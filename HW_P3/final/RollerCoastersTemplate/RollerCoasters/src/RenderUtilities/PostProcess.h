@@ -0,0 +1,166 @@
+#ifndef POST_PROCESS_H
+#define POST_PROCESS_H
+
+#include <glad/glad.h>
+
+#include "Shader.h"
+#include "GLState.h"
+#include "RenderTargetPool.h"
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <algorithm>
+#include <iostream>
+
+// a chain of full screen passes, each one its own small program instead of one shader switching over every effect.
+// enabled passes run in the order they were added, each reading the previous one's output,
+// and the last one writes straight into the default framebuffer.
+// intermediate targets come from the render target pool and go back as soon as the next pass has read them.
+// a pass can run at a fraction of the window size, the next pass (or the final blit) scales it back up.
+// when nothing is enabled the scene should be drawn straight into the default framebuffer, see active()
+class PostProcess
+{
+public:
+	struct Pass
+	{
+		std::string name;
+		Shader* shader;
+		float scale;
+		bool enabled;
+		// sets the pass' own uniforms and binds extra textures from unit 1 on, the input is always on unit 0
+		std::function<void(Shader*)> bind;
+	};
+
+	PostProcess()
+	{
+		float quad[] = {
+			// positions   // texCoords
+			-1.0f,  1.0f,  0.0f, 1.0f,
+			-1.0f, -1.0f,  0.0f, 0.0f,
+			 1.0f, -1.0f,  1.0f, 0.0f,
+
+			-1.0f,  1.0f,  0.0f, 1.0f,
+			 1.0f, -1.0f,  1.0f, 0.0f,
+			 1.0f,  1.0f,  1.0f, 1.0f
+		};
+		glGenVertexArrays(1, &this->vao);
+		glGenBuffers(1, &this->vbo);
+		GLState::bind_vertex_array(this->vao);
+		glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+		GLState::bind_vertex_array(0);
+	}
+	PostProcess(const PostProcess&) = delete;
+	PostProcess& operator=(const PostProcess&) = delete;
+	~PostProcess()
+	{
+		glDeleteBuffers(1, &this->vbo);
+		glDeleteVertexArrays(1, &this->vao);
+		GLState::invalidate();
+	}
+
+	// scale is the fraction of the window the pass renders at, 1, 0.5 or 0.25
+	void add(const std::string& name, Shader* shader, float scale = 1.0f, std::function<void(Shader*)> bind = nullptr)
+	{
+		this->passes.push_back({ name, shader, scale, false, bind });
+	}
+
+	void enable(const std::string& name, bool on)
+	{
+		for (Pass& pass : this->passes)
+			if (pass.name == name)
+				pass.enabled = on;
+	}
+
+	bool enabled(const std::string& name) const
+	{
+		for (const Pass& pass : this->passes)
+			if (pass.name == name)
+				return pass.enabled;
+		return false;
+	}
+
+	// false means there is nothing to do and the scene can skip the offscreen copy
+	bool active() const
+	{
+		for (const Pass& pass : this->passes)
+			if (pass.enabled)
+				return true;
+		return false;
+	}
+
+	// draws the full screen quad, for passes that run outside the chain
+	void quad()
+	{
+		GLState::bind_vertex_array(this->vao);
+		glDrawArrays(GL_TRIANGLES, 0, 6);
+		GLState::bind_vertex_array(0);
+	}
+
+	// runs every enabled pass over the scene target, w and h are the window size.
+	// the scene target is left to the caller to release
+	void run(RenderTargetPool& pool, RenderTargetPool::Target* scene, int w, int h)
+	{
+		std::vector<Pass*> chain;
+		for (Pass& pass : this->passes)
+			if (pass.enabled)
+				chain.push_back(&pass);
+		if (chain.empty())
+			return;
+
+		GLState::disable(GL_DEPTH_TEST);
+		GLState::bind_vertex_array(this->vao);
+		RenderTargetPool::Target* input = scene;
+		for (size_t i = 0; i < chain.size(); i++) {
+			Pass* pass = chain[i];
+			int pass_w = (std::max)(1, (int)(w * pass->scale)), pass_h = (std::max)(1, (int)(h * pass->scale));
+			bool last = i + 1 == chain.size();
+			// a scaled last pass still needs a target, it gets blitted up afterwards
+			RenderTargetPool::Target* out = last && pass->scale == 1.0f ? nullptr : pool.acquire({ pass_w, pass_h, GL_RGB8, 0 });
+			GLState::bind_framebuffer(GL_FRAMEBUFFER, out ? out->fbo : 0);
+			glViewport(0, 0, pass_w, pass_h);
+
+			pass->shader->Use();
+			pass->shader->setInt(u_screenTexture, 0);
+			pass->shader->setFloat(u_screen_w, (float)w);
+			pass->shader->setFloat(u_screen_h, (float)h);
+			pass->shader->setVec2(u_texelStep, 1.0f / input->desc.w, 1.0f / input->desc.h);
+			if (pass->bind)
+				pass->bind(pass->shader);
+			GLState::active_texture(GL_TEXTURE0);
+			GLState::bind_texture(GL_TEXTURE_2D, input->texture);
+			glDrawArrays(GL_TRIANGLES, 0, 6);
+
+			// read, so the next pass of the same size can write over it
+			if (input != scene)
+				pool.release(input);
+			input = out;
+		}
+		if (input) {
+			GLState::bind_framebuffer(GL_READ_FRAMEBUFFER, input->fbo);
+			GLState::bind_framebuffer(GL_DRAW_FRAMEBUFFER, 0);
+			glBlitFramebuffer(0, 0, input->desc.w, input->desc.h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+			pool.release(input);
+		}
+		GLState::bind_framebuffer(GL_FRAMEBUFFER, 0);
+		GLState::bind_vertex_array(0);
+		GLState::use_program(0);
+		glViewport(0, 0, w, h);
+		GLState::enable(GL_DEPTH_TEST);
+	}
+
+private:
+	const Shader::Handle u_screenTexture = Shader::handle("screenTexture");
+	const Shader::Handle u_screen_w = Shader::handle("screen_w");
+	const Shader::Handle u_screen_h = Shader::handle("screen_h");
+	const Shader::Handle u_texelStep = Shader::handle("u_texelStep");
+
+	GLuint vao = 0, vbo = 0;
+	std::vector<Pass> passes;
+};
+#endif
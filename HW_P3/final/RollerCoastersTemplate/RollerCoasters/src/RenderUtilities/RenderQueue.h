@@ -0,0 +1,113 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+
+#include "Shader.h"
+#include "GLState.h"
+
+#include <vector>
+#include <map>
+#include <set>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// the draws of a frame, collected first and run in the order of a 64 bit key instead of the order they were submitted.
+// from the top bit down an opaque key holds the pass, the program, the texture and the distance near to far,
+// so each program is made current once, each texture is bound once per program and close objects fill the depth buffer first.
+// transparent draws sort by distance far to near right after the pass, they have to blend over what is behind them.
+// what every draw of a program shares (camera, light) is set once per frame by the program's setup, not per draw
+class RenderQueue
+{
+public:
+	// the sky goes after everything opaque, where the depth test throws most of it away
+	enum Pass { PASS_OPAQUE = 0, PASS_SKY = 1, PASS_TRANSPARENT = 2 };
+
+	struct Item
+	{
+		uint64_t key;
+		Shader* shader;		// nullptr for draws that set up their own programs and textures
+		GLuint texture;		// bound to unit 0 before the draw, 0 when the draw binds its own
+		std::function<void(Shader*)> draw;	// per draw uniforms, other texture units, then the draw call
+	};
+
+	// draws in the last flush, the switches they saved are counted by GLState
+	int draws = 0;
+
+	RenderQueue() {}
+	RenderQueue(const RenderQueue&) = delete;
+	RenderQueue& operator=(const RenderQueue&) = delete;
+
+	// what runs the first time shader is made current in a flush
+	void program(Shader* shader, std::function<void(Shader*)> setup)
+	{
+		this->setups[shader] = setup;
+	}
+
+	// depth is the distance from the camera
+	void submit(Pass pass, Shader* shader, GLuint texture, float depth, std::function<void(Shader*)> draw)
+	{
+		uint64_t program = id(shader) & 0x3fff;
+		uint64_t material = texture & 0xffff;
+		uint64_t distance = bits((std::max)(depth, 0.0f));
+		uint64_t key = (uint64_t)pass << 62;
+		if (pass == PASS_TRANSPARENT)
+			key |= (~distance & 0xffffffff) << 30 | program << 16 | material;
+		else
+			key |= program << 48 | material << 32 | distance;
+		this->items.push_back({ key, shader, texture, draw });
+	}
+
+	// sorts and runs everything submitted since the last flush, then empties the queue
+	void flush()
+	{
+		// equal keys keep the order they came in
+		std::stable_sort(this->items.begin(), this->items.end(), [](const Item& a, const Item& b) { return a.key < b.key; });
+
+		this->draws = 0;
+		std::set<Shader*> set_up;
+		for (Item& item : this->items) {
+			// in key order a program or texture that is already there is skipped by GLState
+			if (item.shader) {
+				item.shader->Use();
+				auto setup = this->setups.find(item.shader);
+				if (setup != this->setups.end() && set_up.insert(item.shader).second)
+					setup->second(item.shader);
+			}
+			if (item.texture)
+				GLState::bind_texture(GL_TEXTURE0, GL_TEXTURE_2D, item.texture);
+			item.draw(item.shader);
+			this->draws++;
+		}
+		this->items.clear();
+		GLState::active_texture(GL_TEXTURE0);
+		GLState::use_program(0);
+	}
+
+private:
+	std::vector<Item> items;
+	std::map<Shader*, std::function<void(Shader*)>> setups;
+	std::map<Shader*, uint64_t> ids;
+
+	// small numbers for the programs in the order they were first seen, the key only has room for 14 bits
+	uint64_t id(Shader* shader)
+	{
+		if (!shader)
+			return 0;
+		auto it = this->ids.find(shader);
+		if (it == this->ids.end())
+			it = this->ids.insert({ shader, this->ids.size() + 1 }).first;
+		return it->second;
+	}
+
+	// the bits of a positive float sort like the float itself
+	static uint64_t bits(float depth)
+	{
+		uint32_t b;
+		std::memcpy(&b, &depth, sizeof(b));
+		return b;
+	}
+};
+#endif
@@ -0,0 +1,198 @@
+#ifndef RENDER_TARGET_POOL_H
+#define RENDER_TARGET_POOL_H
+
+#include <glad/glad.h>
+
+#include "GLState.h"
+
+#include <vector>
+#include <string>
+#include <map>
+#include <iostream>
+
+// hands out framebuffers with one color texture (and optionally a depth/stencil texture) by size and format.
+// transient targets are acquired and released inside a frame, a released target goes back to the pool right away
+// and the next acquire with the same description gets the same memory, so passes that don't overlap share it.
+// named targets live across frames (history buffers) and are rebuilt when their description changes.
+// anything nobody asked for during the last frame is deleted, which also takes care of window resizes
+class RenderTargetPool
+{
+public:
+	struct Desc
+	{
+		int w, h;
+		GLenum color;		// sized internal format, GL_RGB8, GL_RGBA16F ...
+		GLenum depth;		// 0 for none, GL_DEPTH24_STENCIL8 ...
+
+		bool operator==(const Desc& o) const { return w == o.w && h == o.h && color == o.color && depth == o.depth; }
+	};
+
+	struct Target
+	{
+		GLuint fbo = 0, texture = 0, depth = 0;
+		Desc desc;
+		bool busy = false;
+		int last_frame = 0;
+	};
+
+	RenderTargetPool() {}
+	RenderTargetPool(const RenderTargetPool&) = delete;
+	RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+	~RenderTargetPool()
+	{
+		for (Target* t : this->targets)
+			destroy(t);
+		for (auto& named : this->named_targets)
+			destroy(named.second);
+	}
+
+	// call once at the start of every frame, before anything is acquired
+	void frame()
+	{
+		this->current++;
+		for (size_t i = 0; i < this->targets.size();) {
+			Target* t = this->targets[i];
+			if (t->busy)
+				std::cout << "ERROR::RENDER_TARGET_POOL::TARGET_NOT_RELEASED " << t->desc.w << "x" << t->desc.h << std::endl;
+			t->busy = false;
+			if (t->last_frame < this->current - 1) {
+				destroy(t);
+				this->targets[i] = this->targets.back();
+				this->targets.pop_back();
+			}
+			else
+				i++;
+		}
+		for (auto it = this->named_targets.begin(); it != this->named_targets.end();) {
+			if (it->second->last_frame < this->current - 1) {
+				destroy(it->second);
+				it = this->named_targets.erase(it);
+			}
+			else
+				++it;
+		}
+	}
+
+	// a free target matching desc, valid until release() or the end of the frame
+	Target* acquire(const Desc& desc)
+	{
+		for (Target* t : this->targets) {
+			if (!t->busy && t->desc == desc) {
+				t->busy = true;
+				t->last_frame = this->current;
+				return t;
+			}
+		}
+		Target* t = create(desc);
+		t->busy = true;
+		this->targets.push_back(t);
+		return t;
+	}
+
+	// once released the target may be handed to the next acquire, don't read it afterwards
+	void release(Target* t)
+	{
+		if (t)
+			t->busy = false;
+	}
+
+	// a target that keeps its contents between frames, the pointer stays valid as long as it is asked for every frame.
+	// contents are lost when desc changes
+	Target* named(const std::string& name, const Desc& desc)
+	{
+		Target*& t = this->named_targets[name];
+		if (t && !(t->desc == desc)) {
+			destroy(t);
+			t = nullptr;
+		}
+		if (!t)
+			t = create(desc);
+		t->last_frame = this->current;
+		return t;
+	}
+
+	// targets alive right now, transient and named
+	int count() const { return (int)(this->targets.size() + this->named_targets.size()); }
+
+	// gpu memory held by every target, transient and named
+	size_t bytes() const
+	{
+		size_t total = 0;
+		for (const Target* t : this->targets)
+			total += bytes(t->desc);
+		for (auto& named : this->named_targets)
+			total += bytes(named.second->desc);
+		return total;
+	}
+
+private:
+	static size_t texel_size(GLenum format)
+	{
+		switch (format) {
+		case GL_R8: return 1;
+		case GL_RG8: case GL_R16F: return 2;
+		case GL_RGB8: return 3;
+		case GL_RG16F: case GL_R32F: case GL_RGBA8: case GL_DEPTH24_STENCIL8: case GL_DEPTH_COMPONENT24: return 4;
+		case GL_RGB16F: return 6;
+		case GL_RGBA16F: case GL_RG32F: return 8;
+		case GL_RGBA32F: return 16;
+		default: return 4;
+		}
+	}
+
+	static size_t bytes(const Desc& desc)
+	{
+		return (size_t)desc.w * desc.h * (texel_size(desc.color) + (desc.depth ? texel_size(desc.depth) : 0));
+	}
+
+	Target* create(const Desc& desc)
+	{
+		Target* t = new Target();
+		t->desc = desc;
+		t->last_frame = this->current;
+		glGenFramebuffers(1, &t->fbo);
+		GLState::bind_framebuffer(GL_FRAMEBUFFER, t->fbo);
+		glGenTextures(1, &t->texture);
+		GLState::bind_texture(GL_TEXTURE_2D, t->texture);
+		glTexStorage2D(GL_TEXTURE_2D, 1, desc.color, desc.w, desc.h);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, t->texture, 0);
+		// depth is a texture rather than a renderbuffer so later passes can read it
+		if (desc.depth) {
+			glGenTextures(1, &t->depth);
+			GLState::bind_texture(GL_TEXTURE_2D, t->depth);
+			glTexStorage2D(GL_TEXTURE_2D, 1, desc.depth, desc.w, desc.h);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			GLenum attachment = desc.depth == GL_DEPTH24_STENCIL8 || desc.depth == GL_DEPTH32F_STENCIL8 ?
+				GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+			glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, t->depth, 0);
+		}
+		GLState::bind_texture(GL_TEXTURE_2D, 0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cout << "ERROR::RENDER_TARGET_POOL::FRAMEBUFFER_NOT_COMPLETE" << std::endl;
+		GLState::bind_framebuffer(GL_FRAMEBUFFER, 0);
+		return t;
+	}
+
+	void destroy(Target* t)
+	{
+		glDeleteFramebuffers(1, &t->fbo);
+		glDeleteTextures(1, &t->texture);
+		if (t->depth)
+			glDeleteTextures(1, &t->depth);
+		// the names can come back for new objects while GLState still thinks they are bound
+		GLState::invalidate();
+		delete t;
+	}
+
+	int current = 0;
+	std::vector<Target*> targets;
+	std::map<std::string, Target*> named_targets;
+};
+#endif
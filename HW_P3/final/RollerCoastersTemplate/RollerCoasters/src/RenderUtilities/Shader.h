@@ -3,12 +3,25 @@
 
 #include <glad/glad.h>
 
+#include "GLState.h"
+
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <filesystem>
+#include <iterator>
+#include <cstring>
+#include <cstdio>
 
+// GL_KHR_parallel_shader_compile / GL_ARB_parallel_shader_compile, not in our glad
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
 
 
 class Shader
@@ -26,61 +39,366 @@ public:
 	//DEFINE_ENUM_FLAG_OPERATORS(Type);
 
 	Type type = NULL_SHADER;
-	// Constructor generates the shader on the fly
-	Shader(const GLchar* vert, const GLchar* tesc, const GLchar* tese, const char* geom, const char* frag)
+	// a permutation key, each entry becomes a #define ("NAME" or "NAME VALUE") right after #version
+	typedef std::vector<std::string> Defines;
+
+	// Constructor generates the shader on the fly.
+	// #include "file" lines are resolved relative to the including file, and the defines are injected in every stage.
+	// a program linked before with the same sources on the same driver is loaded from the binary cache instead.
+	// with wait = false the compile is only handed to the driver, poll ready() before using the program
+	Shader(const GLchar* vert, const GLchar* tesc, const GLchar* tese, const char* geom, const char* frag,
+		const Defines& defines = Defines(), bool wait = true)
 	{
-		std::vector<GLuint> shaders;
-		if (vert)
+		const GLchar* paths[STAGE_COUNT] = { vert, tesc, tese, geom, frag };
+		std::string sources[STAGE_COUNT];
+		for (int i = 0; i < STAGE_COUNT; i++)
 		{
-			shaders.push_back(this->compileShader(GL_VERTEX_SHADER, this->readCode(vert).c_str()));
-			this->type = (Shader::Type)(this->type | Type::VERTEX_SHADER);
+			if (!paths[i])
+				continue;
+			sources[i] = this->preprocess(paths[i], defines);
+			this->type = (Shader::Type)(this->type | (1 << i));
 		}
-		if (tesc)
+
+		this->Program = glCreateProgram();
+		this->cache = this->cachePath(sources);
+		if (this->loadBinary(this->cache))
 		{
-			shaders.push_back(this->compileShader(GL_TESS_CONTROL_SHADER, this->readCode(tesc).c_str()));
-			this->type = (Shader::Type)(this->type | Type::TESS_CONTROL_SHADER);
+			this->linked = true;
+			this->reflectUniforms();
+			return;
 		}
-		if (tese)
+		this->link(sources);
+		if (wait)
+			this->finish();
+	}
+	// true once the program is linked. with parallel shader compile this never blocks,
+	// without it the first call waits for the driver just like the constructor would
+	bool ready()
+	{
+		if (this->linked)
+			return true;
+		if (parallelCompile())
 		{
-			shaders.push_back(this->compileShader(GL_TESS_EVALUATION_SHADER, this->readCode(tese).c_str()));
-			this->type = (Shader::Type)(this->type | Type::TESS_EVALUATION_SHADER);
+			GLint done = GL_FALSE;
+			glGetProgramiv(this->Program, GL_COMPLETION_STATUS_KHR, &done);
+			if (!done)
+				return false;
 		}
-		if (geom)
+		this->finish();
+		return true;
+	}
+	// the program for this set of defines, compiled the first time the set is asked for and shared after that
+	static Shader* variant(const GLchar* vert, const GLchar* tesc, const GLchar* tese, const char* geom, const char* frag,
+		Defines defines)
+	{
+		std::sort(defines.begin(), defines.end());
+		std::string key;
+		for (const GLchar* path : { vert, tesc, tese, geom, frag })
+			key += std::string(path ? path : "") + '|';
+		for (const std::string& define : defines)
+			key += define + ';';
+		Shader*& shader = variants()[key];
+		if (!shader)
+			shader = new Shader(vert, tesc, tese, geom, frag, defines);
+		return shader;
+	}
+	// where linked program binaries are kept between runs, empty turns the cache off
+	static std::string& cacheDirectory()
+	{
+		static std::string directory = "./shader_cache/";
+		return directory;
+	}
+	// Uses the current shader
+	void Use()
+	{
+		GLState::use_program(this->Program);
+	}
+
+	// a uniform name turned into a small id, shared by every program.
+	// get it once (a static at the call site) and the per frame path never touches the string again
+	typedef int Handle;
+	static Handle handle(const std::string& name)
+	{
+		auto it = handleIds().find(name);
+		if (it != handleIds().end())
+			return it->second;
+		Handle h = (Handle)handleNames().size();
+		handleIds()[name] = h;
+		handleNames().push_back(name);
+		return h;
+	}
+	// location of the uniform in this program, -1 if it is not active
+	GLint location(Handle h)
+	{
+		if (h >= (Handle)this->locations.size())
+			this->locations.resize(h + 1, UNRESOLVED);
+		if (this->locations[h] == UNRESOLVED)
 		{
-			shaders.push_back(this->compileShader(GL_GEOMETRY_SHADER, this->readCode(geom).c_str()));
-			this->type = (Shader::Type)(this->type | Type::GEOMETRY_SHADER);
+			auto it = this->uniforms.find(handleNames()[h]);
+			this->locations[h] = it == this->uniforms.end() ? -1 : it->second;
 		}
-		if (frag)
+		return this->locations[h];
+	}
+	void setInt(Handle h, GLint v) { glUniform1i(this->location(h), v); }
+	void setFloat(Handle h, GLfloat v) { glUniform1f(this->location(h), v); }
+	void setVec2(Handle h, GLfloat x, GLfloat y) { glUniform2f(this->location(h), x, y); }
+	void setVec3(Handle h, GLfloat x, GLfloat y, GLfloat z) { glUniform3f(this->location(h), x, y, z); }
+	void setVec3(Handle h, const GLfloat* v) { glUniform3fv(this->location(h), 1, v); }
+	void setMat3(Handle h, const GLfloat* m) { glUniformMatrix3fv(this->location(h), 1, GL_FALSE, m); }
+	void setMat4(Handle h, const GLfloat* m) { glUniformMatrix4fv(this->location(h), 1, GL_FALSE, m); }
+private:
+	static const GLint UNRESOLVED = -2;
+	// every active uniform of the program by name, filled once after linking
+	std::unordered_map<std::string, GLint> uniforms;
+	// location per handle, resolved from uniforms on first use
+	std::vector<GLint> locations;
+
+	static std::unordered_map<std::string, Handle>& handleIds()
+	{
+		static std::unordered_map<std::string, Handle> ids;
+		return ids;
+	}
+	static std::vector<std::string>& handleNames()
+	{
+		static std::vector<std::string> names;
+		return names;
+	}
+	static std::unordered_map<std::string, Shader*>& variants()
+	{
+		static std::unordered_map<std::string, Shader*> shaders;
+		return shaders;
+	}
+
+	void reflectUniforms()
+	{
+		// lookups made before the link finished cached -1, they resolve again against the linked program
+		this->uniforms.clear();
+		this->locations.clear();
+		GLint count = 0, max_length = 0;
+		glGetProgramiv(this->Program, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(this->Program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+		std::vector<GLchar> name(max_length + 1);
+		for (GLint i = 0; i < count; i++)
 		{
-			shaders.push_back(this->compileShader(GL_FRAGMENT_SHADER, this->readCode(frag).c_str()));
-			this->type = (Shader::Type)(this->type | Type::FRAGMENT_SHADER);
+			GLsizei length;
+			GLint size;
+			GLenum type;
+			glGetActiveUniform(this->Program, i, (GLsizei)name.size(), &length, &size, &type, name.data());
+			std::string uniform(name.data(), length);
+			GLint loc = glGetUniformLocation(this->Program, uniform.c_str());
+			// members of uniform blocks have no location
+			if (loc < 0)
+				continue;
+			this->uniforms[uniform] = loc;
+			// arrays are reported as "name[0]", make "name" and every element reachable too
+			if (uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0)
+			{
+				std::string base = uniform.substr(0, uniform.size() - 3);
+				this->uniforms[base] = loc;
+				for (GLint j = 1; j < size; j++)
+				{
+					std::string element = base + "[" + std::to_string(j) + "]";
+					this->uniforms[element] = glGetUniformLocation(this->Program, element.c_str());
+				}
+			}
 		}
-		// Shader Program
-		GLint success;
-		GLchar infoLog[512];
-		this->Program = glCreateProgram();
+	}
 
-		for (GLuint shader : shaders)
-			glAttachShader(this->Program, shader);
+	static const int STAGE_COUNT = 5;
+	static GLenum stageType(int i)
+	{
+		static const GLenum stages[STAGE_COUNT] = {
+			GL_VERTEX_SHADER, GL_TESS_CONTROL_SHADER, GL_TESS_EVALUATION_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER
+		};
+		return stages[i];
+	}
+
+	bool linked = false;
+	std::string cache;
+	// stages handed to the driver, their status is only read in finish()
+	std::vector<std::pair<GLenum, GLuint>> stages;
+
+	static bool parallelCompile()
+	{
+		static int supported = -1;
+		if (supported < 0)
+		{
+			supported = 0;
+			GLint count = 0;
+			glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+			for (GLint i = 0; i < count; i++)
+			{
+				const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+				if (name && (!strcmp(name, "GL_KHR_parallel_shader_compile") || !strcmp(name, "GL_ARB_parallel_shader_compile")))
+					supported = 1;
+			}
+		}
+		return supported == 1;
+	}
 
+	// compiles and links without asking for any status, so the driver is free to do it in the background
+	void link(const std::string* sources)
+	{
+		for (int i = 0; i < STAGE_COUNT; i++)
+		{
+			if (!(this->type & (1 << i)))
+				continue;
+			const char* code = sources[i].c_str();
+			GLuint shader = glCreateShader(stageType(i));
+			glShaderSource(shader, 1, &code, NULL);
+			glCompileShader(shader);
+			glAttachShader(this->Program, shader);
+			this->stages.push_back(std::make_pair(stageType(i), shader));
+		}
+		glProgramParameteri(this->Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 		glLinkProgram(this->Program);
+	}
+	// reports errors, stores the binary and reflects the uniforms once the link is done
+	void finish()
+	{
+		for (auto& stage : this->stages)
+			this->checkShader(stage.first, stage.second);
 		// Print linking errors if any
+		GLint success;
+		GLchar infoLog[512];
 		glGetProgramiv(this->Program, GL_LINK_STATUS, &success);
 		if (!success)
 		{
 			glGetProgramInfoLog(this->Program, 512, NULL, infoLog);
 			std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
 		}
+		for (auto& stage : this->stages)
+		{
+			glDetachShader(this->Program, stage.second);
+			glDeleteShader(stage.second);
+		}
+		this->stages.clear();
 
-		for (GLuint shader : shaders)
-			glDeleteShader(shader);
+		this->saveBinary(this->cache);
+		this->reflectUniforms();
+		this->linked = true;
 	}
-	// Uses the current shader
-	void Use()
+
+	// cache file named after a hash of every stage's source and the driver that compiled it,
+	// so editing a shader or updating the driver simply misses the cache
+	std::string cachePath(const std::string* sources)
 	{
-		glUseProgram(this->Program);
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		if (cacheDirectory().empty() || formats == 0)
+			return "";
+		// FNV-1a
+		unsigned long long hash = 14695981039346656037ULL;
+		auto mix = [&hash](const char* data, size_t size) {
+			for (size_t i = 0; i < size; i++)
+				hash = (hash ^ (unsigned char)data[i]) * 1099511628211ULL;
+		};
+		for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+		{
+			const char* driver = (const char*)glGetString(name);
+			if (driver)
+				mix(driver, strlen(driver) + 1);
+		}
+		for (int i = 0; i < STAGE_COUNT; i++)
+		{
+			char stage = (char)('0' + ((this->type >> i) & 1));
+			mix(&stage, 1);
+			mix(sources[i].c_str(), sources[i].size() + 1);
+		}
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.bin", hash);
+		return cacheDirectory() + name;
+	}
+	bool loadBinary(const std::string& path)
+	{
+		if (path.empty())
+			return false;
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		GLenum format;
+		std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if (binary.size() <= sizeof(format))
+			return false;
+		memcpy(&format, binary.data(), sizeof(format));
+		glProgramBinary(this->Program, format, binary.data() + sizeof(format), (GLsizei)(binary.size() - sizeof(format)));
+		GLint success;
+		glGetProgramiv(this->Program, GL_LINK_STATUS, &success);
+		// the driver may reject binaries it produced itself (e.g. after an update), just compile again
+		return success == GL_TRUE;
+	}
+	void saveBinary(const std::string& path)
+	{
+		GLint success, length = 0;
+		glGetProgramiv(this->Program, GL_LINK_STATUS, &success);
+		glGetProgramiv(this->Program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (path.empty() || !success || length <= 0)
+			return;
+		GLenum format;
+		std::vector<char> binary(sizeof(format) + length);
+		glGetProgramBinary(this->Program, length, NULL, &format, binary.data() + sizeof(format));
+		memcpy(binary.data(), &format, sizeof(format));
+		std::error_code error;
+		std::filesystem::create_directories(cacheDirectory(), error);
+		std::ofstream file(path, std::ios::binary);
+		if (!file)
+		{
+			std::cout << "ERROR::SHADER::CACHE::WRITE_FAILED\n" << path << std::endl;
+			return;
+		}
+		file.write(binary.data(), binary.size());
+	}
+
+	// reads a stage, puts the defines after its #version line and pastes in its includes.
+	// #line directives keep the line numbers in compile errors pointing at the right file line
+	std::string preprocess(const std::string& path, const Defines& defines)
+	{
+		std::unordered_set<std::string> included;
+		std::string code = this->resolveIncludes(path, included, 0);
+		if (defines.empty())
+			return code;
+		std::string injected;
+		for (const std::string& define : defines)
+			injected += "#define " + define + "\n";
+		size_t version = code.find("#version");
+		if (version == std::string::npos)
+			return injected + "#line 1\n" + code;
+		size_t end = code.find('\n', version);
+		if (end == std::string::npos)
+			return code + "\n" + injected;
+		int line = (int)std::count(code.begin(), code.begin() + end, '\n') + 2;
+		return code.substr(0, end + 1) + injected + "#line " + std::to_string(line) + "\n" + code.substr(end + 1);
+	}
+	std::string resolveIncludes(const std::string& path, std::unordered_set<std::string>& included, int depth)
+	{
+		// every file goes in once, which also stops include cycles
+		if (depth > 16 || !included.insert(std::filesystem::path(path).lexically_normal().generic_string()).second)
+			return "";
+		std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+		std::istringstream in(this->readCode(path.c_str()));
+		std::string code, line;
+		int number = 0;
+		while (std::getline(in, line))
+		{
+			number++;
+			size_t start = line.find_first_not_of(" \t");
+			if (start != std::string::npos && line.compare(start, 8, "#include") == 0)
+			{
+				size_t open = line.find('"', start), close = line.find('"', open + 1);
+				if (open == std::string::npos || close == std::string::npos)
+				{
+					std::cout << "ERROR::SHADER::INCLUDE::BAD_DIRECTIVE\n" << path << ":" << number << std::endl;
+					continue;
+				}
+				std::string file = this->resolveIncludes(directory + line.substr(open + 1, close - open - 1), included, depth + 1);
+				if (!file.empty())
+					code += "#line 1\n" + file + "#line " + std::to_string(number + 1) + "\n";
+				continue;
+			}
+			code += line + "\n";
+		}
+		return code;
 	}
-private:
 	std::string readCode(const GLchar* path)
 	{
 		std::string code;
@@ -107,15 +425,10 @@ private:
 		}
 		return code;
 	}
-	GLuint compileShader(GLenum shader_type, const char* code)
+	void checkShader(GLenum shader_type, GLuint shader_number)
 	{
-		GLuint shader_number;
 		GLint success;
 		GLchar infoLog[512];
-		// Vertex Shader
-		shader_number = glCreateShader(shader_type);
-		glShaderSource(shader_number, 1, &code, NULL);
-		glCompileShader(shader_number);
 		// Print compile errors if any
 		glGetShaderiv(shader_number, GL_COMPILE_STATUS, &success);
 		if (!success)
@@ -132,7 +445,6 @@ private:
 			else if (shader_type == GL_FRAGMENT_SHADER)
 				std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
 		}
-		return shader_number;
 	}
 };
 
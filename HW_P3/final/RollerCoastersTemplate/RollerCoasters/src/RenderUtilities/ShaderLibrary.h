@@ -0,0 +1,37 @@
+#ifndef SHADER_LIBRARY_H
+#define SHADER_LIBRARY_H
+
+#include "Shader.h"
+
+#include <vector>
+#include <algorithm>
+
+// hands every program to the driver up front and polls them instead of waiting on each in turn.
+// with parallel shader compile the driver builds them on its own threads while the scene keeps loading,
+// so startup costs about as much as the slowest program instead of the sum of all of them
+class ShaderLibrary
+{
+public:
+	// starts compiling right away, the program can't be used until ready() says so
+	Shader* add(const GLchar* vert, const GLchar* tesc, const GLchar* tese, const char* geom, const char* frag,
+		const Shader::Defines& defines = Shader::Defines())
+	{
+		Shader* shader = new Shader(vert, tesc, tese, geom, frag, defines, false);
+		this->pending.push_back(shader);
+		return shader;
+	}
+
+	// true once every added program is linked, never blocks when the driver compiles in parallel
+	bool ready()
+	{
+		this->pending.erase(std::remove_if(this->pending.begin(), this->pending.end(),
+			[](Shader* shader) { return shader->ready(); }), this->pending.end());
+		return this->pending.empty();
+	}
+
+	int waiting() const { return (int)this->pending.size(); }
+
+private:
+	std::vector<Shader*> pending;
+};
+#endif
@@ -4,6 +4,8 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "GLState.h"
+
 
 class Texture2D
 {
@@ -31,7 +33,7 @@ public:
 
 		glGenTextures(1, &this->id);
 
-		glBindTexture(GL_TEXTURE_2D, this->id);
+		GLState::bind_texture(GL_TEXTURE_2D, this->id);
 		glGenerateMipmap(GL_TEXTURE_2D);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -41,19 +43,19 @@ public:
 			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, img.cols, img.rows, 0, GL_BGR, GL_UNSIGNED_BYTE, img.data);
 		else if (img.type() == CV_8UC4)
 			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, img.cols, img.rows, 0, GL_BGRA, GL_UNSIGNED_BYTE, img.data);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		GLState::bind_texture(GL_TEXTURE_2D, 0);
 
 		img.release();
 	}
 	void bind(GLenum bind_unit)
 	{
-		glActiveTexture(GL_TEXTURE0 + bind_unit);
-		glBindTexture(GL_TEXTURE_2D, this->id);
+		GLState::active_texture(GL_TEXTURE0 + bind_unit);
+		GLState::bind_texture(GL_TEXTURE_2D, this->id);
 	}
 	static void unbind(GLenum bind_unit)
 	{
-		glActiveTexture(GL_TEXTURE0 + bind_unit);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		GLState::active_texture(GL_TEXTURE0 + bind_unit);
+		GLState::bind_texture(GL_TEXTURE_2D, 0);
 	}
 	glm::ivec2 size;
 private:
@@ -0,0 +1,147 @@
+#ifndef SCENE_GRAPH_H
+#define SCENE_GRAPH_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <cfloat>
+
+#include "Camera.h"
+#include "RenderUtilities/RenderQueue.h"
+
+// one object of the scene, or a group of them when it has children.
+// the box is in the node's own space, usually the bounds of its model's meshes.
+// a visible node hands its draws to the render queue. a leaf without a box (low above high) is never culled,
+// the skybox or something that culls itself, a group without one is culled by its children's
+class SceneNode
+{
+public:
+    std::string name;
+    glm::mat4 local = glm::mat4(1.0f);         // relative to the parent
+    glm::vec3 low = glm::vec3(FLT_MAX);
+    glm::vec3 high = glm::vec3(-FLT_MAX);
+    bool enabled = true;                        // off hides the node and its children, they don't count as culled
+    std::function<void(const SceneNode&, RenderQueue&)> submit;
+    std::vector<SceneNode*> children;
+
+    // set by SceneGraph::update, the box covers the node and all its children
+    glm::mat4 world = glm::mat4(1.0f);
+    glm::vec3 world_low = glm::vec3(FLT_MAX);
+    glm::vec3 world_high = glm::vec3(-FLT_MAX);
+    bool unbounded = false;                     // something under it has no box, so the group can't be culled as a whole
+
+    SceneNode(const std::string& _name = "", std::function<void(const SceneNode&, RenderQueue&)> _submit = nullptr) : name(_name), submit(_submit) {}
+    SceneNode(const SceneNode&) = delete;
+    SceneNode& operator=(const SceneNode&) = delete;
+    ~SceneNode()
+    {
+        for (SceneNode* child : children)
+            delete child;
+    }
+
+    // the node takes ownership of child
+    SceneNode* add(SceneNode* child)
+    {
+        children.push_back(child);
+        return child;
+    }
+
+    void bounds(const glm::vec3& _low, const glm::vec3& _high)
+    {
+        low = _low;
+        high = _high;
+    }
+
+    bool bounded() const { return low.x <= high.x; }
+
+    // middle of the world box, what the render queue sorts by
+    glm::vec3 center() const { return (world_low + world_high) * 0.5f; }
+    // of the sphere around the world box, what levels of detail are picked by
+    float radius() const { return glm::length(world_high - world_low) * 0.5f; }
+};
+
+// the scene as a tree of nodes, culled against the camera every frame before anything is drawn.
+// a group outside the frustum drops its whole subtree without testing the children
+class SceneGraph
+{
+public:
+    SceneNode root = SceneNode("root");
+
+    // statistics of the last cull
+    int nodes_tested = 0;
+    int nodes_drawn = 0;
+    int nodes_culled = 0;                       // subtrees rejected, their children are not counted
+    std::vector<const SceneNode*> culled;       // the rejected subtrees
+
+    // world matrices and boxes from the local ones, call it after moving a node or changing its box
+    void update()
+    {
+        update(root, glm::mat4(1.0f));
+    }
+
+    // the enabled nodes that can be seen from camera, in the order they were added
+    const std::vector<SceneNode*>& cull(const Camera& camera)
+    {
+        glm::vec4 planes[6];
+        camera.frustum(planes);
+        visible.clear();
+        culled.clear();
+        nodes_tested = 0;
+        cull(root, planes);
+        nodes_culled = (int)culled.size();
+        nodes_drawn = (int)visible.size();
+        return visible;
+    }
+
+    // culls and queues the draws of what is left, they run when the queue is flushed
+    void submit(const Camera& camera, RenderQueue& queue)
+    {
+        for (SceneNode* node : cull(camera))
+            node->submit(*node, queue);
+    }
+
+private:
+    std::vector<SceneNode*> visible;
+
+    void update(SceneNode& node, const glm::mat4& parent)
+    {
+        node.world = parent * node.local;
+        node.world_low = glm::vec3(FLT_MAX);
+        node.world_high = glm::vec3(-FLT_MAX);
+        // a group without a box of its own takes its children's
+        node.unbounded = !node.bounded() && node.children.empty();
+        if (node.bounded()) {
+            // the box of the eight transformed corners
+            for (int i = 0; i < 8; i++) {
+                glm::vec3 corner(i & 1 ? node.high.x : node.low.x, i & 2 ? node.high.y : node.low.y, i & 4 ? node.high.z : node.low.z);
+                glm::vec3 p = glm::vec3(node.world * glm::vec4(corner, 1.0f));
+                node.world_low = glm::min(node.world_low, p);
+                node.world_high = glm::max(node.world_high, p);
+            }
+        }
+        for (SceneNode* child : node.children) {
+            update(*child, node.world);
+            node.unbounded = node.unbounded || child->unbounded;
+            node.world_low = glm::min(node.world_low, child->world_low);
+            node.world_high = glm::max(node.world_high, child->world_high);
+        }
+    }
+
+    void cull(SceneNode& node, const glm::vec4 planes[6])
+    {
+        if (!node.enabled)
+            return;
+        nodes_tested++;
+        if (!node.unbounded && !Camera::visible(planes, node.world_low, node.world_high)) {
+            culled.push_back(&node);
+            return;
+        }
+        if (node.submit)
+            visible.push_back(&node);
+        for (SceneNode* child : node.children)
+            cull(*child, planes);
+    }
+};
+#endif
@@ -0,0 +1,147 @@
+#ifndef STATIC_GEOMETRY_H
+#define STATIC_GEOMETRY_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "model.h"
+#include "RenderUtilities/GLState.h"
+
+#include <vector>
+#include <algorithm>
+
+// the storage buffer binding the per draw matrices go to, the STATIC variants of the shaders read it
+#define STATIC_DRAWS_BINDING 1
+
+// the meshes of props that never change, packed at load time into one vertex and one index buffer behind a single VAO.
+// every frame the visible objects are collected into batches, one per program and set of textures,
+// and a batch is one glMultiDrawElementsIndirect: a command per mesh, pointing into the shared buffers,
+// and the object's matrix in a storage buffer that the vertex shader picks with gl_BaseInstanceARB.
+// the batch's program and textures go for all of its meshes, their own textures are not bound
+class StaticGeometry
+{
+public:
+    StaticGeometry() {}
+    StaticGeometry(const StaticGeometry&) = delete;
+    StaticGeometry& operator=(const StaticGeometry&) = delete;
+    ~StaticGeometry()
+    {
+        if (vao) {
+            glDeleteBuffers(1, &vbo);
+            glDeleteBuffers(1, &ebo);
+            glDeleteBuffers(1, &indirect);
+            glDeleteBuffers(1, &draws);
+            glDeleteVertexArrays(1, &vao);
+            GLState::invalidate();
+        }
+    }
+
+    // copies model's meshes in with all their levels of detail, everything has to be added before build(). the handle is for queue()
+    int add(const Model& model)
+    {
+        std::vector<std::vector<DrawElementsIndirectCommand>> levels(model.levels());
+        for (const Mesh& mesh : model.meshes) {
+            GLint base = (GLint)vertices.size();
+            vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+            for (int level = 0; level < model.levels(); level++) {
+                const std::vector<unsigned int>& range = level == 0 ? mesh.indices : mesh.lods[level - 1];
+                DrawElementsIndirectCommand command = { (GLuint)range.size(), 1, (GLuint)indices.size(), base, 0 };
+                levels[level].push_back(command);
+                indices.insert(indices.end(), range.begin(), range.end());
+            }
+        }
+        objects.push_back(levels);
+        return (int)objects.size() - 1;
+    }
+
+    // levels of detail object has, including the full one
+    int levels(int object) const { return (int)objects[object].size(); }
+
+    // uploads what was added, the copies on our side are dropped
+    void build()
+    {
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+        glGenBuffers(1, &ebo);
+        glGenBuffers(1, &indirect);
+        glGenBuffers(1, &draws);
+
+        GLState::bind_vertex_array(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferStorage(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBufferStorage(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), 0);
+        // the same layout as Mesh::setupMesh
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+        GLState::bind_vertex_array(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        std::vector<Vertex>().swap(vertices);
+        std::vector<unsigned int>().swap(indices);
+    }
+
+    // a new empty batch, objects queued to it share one draw() call
+    int batch()
+    {
+        batches.push_back(Batch());
+        return (int)batches.size() - 1;
+    }
+
+    // adds object at world to a batch for this frame's draw(), at a level of detail from Model::lod
+    void queue(int _batch, int object, const glm::mat4& world, int level = 0)
+    {
+        Batch& batch = batches[_batch];
+        GLuint base = (GLuint)batch.models.size();
+        level = (std::min)((std::max)(level, 0), levels(object) - 1);
+        for (DrawElementsIndirectCommand command : objects[object][level]) {
+            command.baseInstance = base;
+            batch.commands.push_back(command);
+        }
+        batch.models.push_back(world);
+    }
+
+    // everything queued to a batch with the current program and textures, in one call. the batch is empty afterwards
+    void draw(int _batch)
+    {
+        Batch& batch = batches[_batch];
+        if (batch.commands.empty())
+            return;
+        // orphaned every time, the driver hands out fresh memory instead of waiting for the last draw to finish
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, draws);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, batch.models.size() * sizeof(glm::mat4), batch.models.data(), GL_STREAM_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, STATIC_DRAWS_BINDING, draws);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, batch.commands.size() * sizeof(DrawElementsIndirectCommand), batch.commands.data(), GL_STREAM_DRAW);
+
+        GLState::bind_vertex_array(vao);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)0, (GLsizei)batch.commands.size(), 0);
+
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        batch.commands.clear();
+        batch.models.clear();
+    }
+
+private:
+    struct Batch
+    {
+        std::vector<DrawElementsIndirectCommand> commands;
+        std::vector<glm::mat4> models;
+    };
+
+    std::vector<Batch> batches;
+    std::vector<std::vector<std::vector<DrawElementsIndirectCommand>>> objects;  // the mesh ranges of every added model, per level
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    GLuint vao = 0, vbo = 0, ebo = 0, indirect = 0, draws = 0;
+};
+#endif
@@ -0,0 +1,127 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "RenderUtilities/GLState.h"
+#include "Utilities/3DUtils.H"
+
+#include <vector>
+
+// the bumpy floor drawFloor draws, built once into an indexed vertex buffer and drawn with one call.
+// every corner is shared by up to four squares, so its height is computed once instead of four times,
+// and it is only computed again when the size, the number of squares or the noise changes.
+// it is still drawn with the fixed-function pipeline, lit with the per vertex normals and textured one texture per square
+class Terrain
+{
+public:
+    Terrain() {}
+    Terrain(const Terrain&) = delete;
+    Terrain& operator=(const Terrain&) = delete;
+    ~Terrain()
+    {
+        if (vao) {
+            glDeleteBuffers(1, &vbo);
+            glDeleteBuffers(1, &ebo);
+            glDeleteVertexArrays(1, &vao);
+            GLState::invalidate();
+        }
+    }
+
+    // like drawFloor(size, squares, texture, noise), a texture of -1 draws it untextured
+    void draw(float size, int squares, GLuint texture, float noise)
+    {
+        if (!vao || size != built_size || squares != built_squares || noise != built_noise)
+            build(size, squares, noise);
+
+        if (texture != (GLuint)-1) {
+            GLState::bind_texture(GL_TEXTURE0, GL_TEXTURE_2D, texture);
+            GLState::enable(GL_TEXTURE_2D);
+        }
+        glColor4f(floorColor3[0], floorColor3[1], floorColor3[2], 1.0f);
+        GLState::bind_vertex_array(vao);
+        glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, 0);
+        GLState::disable(GL_TEXTURE_2D);
+        GLState::bind_texture(GL_TEXTURE0, GL_TEXTURE_2D, 0);
+    }
+
+private:
+    struct Vertex
+    {
+        glm::vec3 position;
+        glm::vec3 normal;
+        glm::vec2 uv;
+    };
+
+    GLuint vao = 0, vbo = 0, ebo = 0;
+    GLsizei count = 0;
+    float built_size = 0.0f, built_noise = 0.0f;
+    int built_squares = 0;
+
+    void build(float size, int squares, float noise)
+    {
+        int side = squares + 1;
+        float step = size / squares;
+        std::vector<float> heights(side * side);
+        for (int z = 0; z < side; z++)
+            for (int x = 0; x < side; x++)
+                heights[z * side + x] = getFloorHeight(-size / 2 + x * step, -size / 2 + z * step, noise);
+
+        std::vector<Vertex> vertices(side * side);
+        for (int z = 0; z < side; z++) {
+            for (int x = 0; x < side; x++) {
+                // the slope between the neighbours, one sided along the edges
+                int x0 = x > 0 ? x - 1 : x, x1 = x < squares ? x + 1 : x;
+                int z0 = z > 0 ? z - 1 : z, z1 = z < squares ? z + 1 : z;
+                float dx = (heights[z * side + x1] - heights[z * side + x0]) / ((x1 - x0) * step);
+                float dz = (heights[z1 * side + x] - heights[z0 * side + x]) / ((z1 - z0) * step);
+                Vertex& v = vertices[z * side + x];
+                v.position = glm::vec3(-size / 2 + x * step, heights[z * side + x], -size / 2 + z * step);
+                v.normal = glm::normalize(glm::vec3(-dx, 1.0f, -dz));
+                // repeats once per square like drawFloor's
+                v.uv = glm::vec2((float)x, (float)z);
+            }
+        }
+
+        // drawFloor's quads split in two, wound the same way
+        std::vector<unsigned int> indices;
+        indices.reserve(squares * squares * 6);
+        for (int x = 0; x < squares; x++) {
+            for (int z = 0; z < squares; z++) {
+                unsigned int a = z * side + x, b = (z + 1) * side + x, c = (z + 1) * side + x + 1, d = z * side + x + 1;
+                unsigned int quad[] = { a, b, c, a, c, d };
+                indices.insert(indices.end(), quad, quad + 6);
+            }
+        }
+        count = (GLsizei)indices.size();
+
+        if (!vao) {
+            glGenVertexArrays(1, &vao);
+            glGenBuffers(1, &vbo);
+            glGenBuffers(1, &ebo);
+            GLState::bind_vertex_array(vao);
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+            // the fixed-function arrays, they are part of the VAO like the generic attributes
+            glEnableClientState(GL_VERTEX_ARRAY);
+            glVertexPointer(3, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, position));
+            glEnableClientState(GL_NORMAL_ARRAY);
+            glNormalPointer(GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+            glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+            glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, uv));
+        }
+        else {
+            GLState::bind_vertex_array(vao);
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        }
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        built_size = size;
+        built_squares = squares;
+        built_noise = noise;
+    }
+};
+#endif
@@ -38,12 +38,49 @@
 #define STB_IMAGE_STATIC
 #define STB_IMAGE_IMPLEMENTATION
 #include "model.h"
+#include "Vegetation.h"
+#include "SceneGraph.h"
+#include "StaticGeometry.h"
+#include "Impostor.h"
+#include "Terrain.h"
 
 #include <array>
+#include <cfloat>
 
 #define _USE_MATH_DEFINES
 #include <math.h>
 
+// uniform handles, resolved per program the first time they are set
+static const Shader::Handle u_projection = Shader::handle("projection");
+static const Shader::Handle u_view = Shader::handle("view");
+static const Shader::Handle u_model = Shader::handle("model");
+static const Shader::Handle u_texture1 = Shader::handle("texture1");
+static const Shader::Handle u_cameraPos = Shader::handle("cameraPos");
+static const Shader::Handle u_lightPos = Shader::handle("lightPos");
+static const Shader::Handle u_lightColor = Shader::handle("lightColor");
+static const Shader::Handle u_albedoMap = Shader::handle("albedoMap");
+static const Shader::Handle u_heightMap = Shader::handle("heightMap");
+static const Shader::Handle u_normalMap = Shader::handle("normalMap");
+static const Shader::Handle u_diffuseTexture = Shader::handle("diffuseTexture");
+static const Shader::Handle u_time = Shader::handle("time");
+static const Shader::Handle u_viewPos = Shader::handle("viewPos");
+static const Shader::Handle u_lightIntensity = Shader::handle("lightIntensity");
+static const Shader::Handle u_specularMap = Shader::handle("specularMap");
+static const Shader::Handle u_diffuseMap = Shader::handle("diffuseMap");
+static const Shader::Handle u_skybox = Shader::handle("skybox");
+static const Shader::Handle u_model_view = Shader::handle("model_view");
+static const Shader::Handle u_velocityTexture = Shader::handle("velocityTexture");
+static const Shader::Handle u_samples = Shader::handle("u_samples");
+static const Shader::Handle u_strength = Shader::handle("u_strength");
+static const Shader::Handle u_depthTexture = Shader::handle("depthTexture");
+static const Shader::Handle u_reprojection = Shader::handle("u_reprojection");
+static const Shader::Handle u_uv_scale = Shader::handle("u_uv_scale");
+static const Shader::Handle u_sharpness = Shader::handle("u_sharpness");
+static const Shader::Handle u_lumaThreshold = Shader::handle("u_lumaThreshold");
+static const Shader::Handle u_mulReduce = Shader::handle("u_mulReduce");
+static const Shader::Handle u_minReduce = Shader::handle("u_minReduce");
+static const Shader::Handle u_maxSpan = Shader::handle("u_maxSpan");
+
 
 #ifdef EXAMPLE_SOLUTION
 #	include "TrainExample/TrainExample.H"
@@ -59,7 +96,7 @@ TrainView(int x, int y, int w, int h, const char* l)
 	: Fl_Gl_Window(x,y,w,h,l)
 //========================================================================
 {
-	mode( FL_RGB|FL_ALPHA|FL_DOUBLE | FL_STENCIL );
+	mode( FL_RGB|FL_ALPHA|FL_DOUBLE | FL_DEPTH | FL_STENCIL );
 
 	resetArcball();
 }
@@ -124,11 +161,11 @@ int TrainView::handle(int event)
 			if ((last_push == FL_LEFT_MOUSE) && (selectedCube >= 0)) {
 				ControlPoint* cp = &m_pTrack->points[selectedCube];
 
-				double r1x, r1y, r1z, r2x, r2y, r2z;
-				getMouseLine(r1x, r1y, r1z, r2x, r2y, r2z);
+				glm::vec3 r1, r2;
+				camera.ray((float)Fl::event_x(), (float)Fl::event_y(), w(), h(), r1, r2);
 
 				double rx, ry, rz;
-				mousePoleGo(r1x, r1y, r1z, r2x, r2y, r2z, 
+				mousePoleGo(r1.x, r1.y, r1.z, r2.x, r2.y, r2.z, 
 								static_cast<double>(cp->pos.x), 
 								static_cast<double>(cp->pos.y),
 								static_cast<double>(cp->pos.z),
@@ -184,7 +221,7 @@ unsigned int loadCubemap(vector<const GLchar*> faces)
 {
 	unsigned int textureID;
 	glGenTextures(1, &textureID);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+	GLState::bind_texture(GL_TEXTURE_CUBE_MAP, textureID);
 
 	int width, height, nrChannels;
 	for (unsigned int i = 0; i < faces.size(); i++)
@@ -210,23 +247,17 @@ unsigned int loadCubemap(vector<const GLchar*> faces)
 	return textureID;
 }
 
-void TrainView::set_fbo(int* framebuffer, unsigned int* textureColorbuffer) {
-
-	glGenFramebuffers(1, (GLuint*)framebuffer);
-	glBindFramebuffer(GL_FRAMEBUFFER, *framebuffer);
-	// create a color attachment texture
-	glGenTextures(1, textureColorbuffer);
-	glBindTexture(GL_TEXTURE_2D, *textureColorbuffer);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w(), h(), 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, *textureColorbuffer, 0);
-
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-		std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
+void TrainView::update_render_scale() {
+	float ms = gpu_timer->milliseconds();
+	if (ms <= 0.0f)
+		return;
+	// leave it alone near the budget so the resolution doesn't pump
+	if (ms < frame_budget_ms * 1.05f && ms > frame_budget_ms * 0.85f)
+		return;
+	// the frame's cost follows the pixel count, which goes with the square of the scale
+	float target = render_scale * sqrt(frame_budget_ms / ms);
+	render_scale += (target - render_scale) * 0.1f;
+	render_scale = (std::min)(1.0f, (std::max)(min_render_scale, render_scale));
 }
 
 glm::mat4 TrainView::getTransformMatrix(glm::mat4 mat, glm::vec3 pos, glm::vec3 scale, glm::vec3 rotate, float rotate_angle) {
@@ -237,105 +268,45 @@ glm::mat4 TrainView::getTransformMatrix(glm::mat4 mat, glm::vec3 pos, glm::vec3
 	return mat;
 }
 
-glm::mat4 billBoardModel(glm::vec3 objectPos, glm::vec3 cameraPos, glm::vec3 cameraUp) {
-	//glm::vec3 treePos(200, 20, -200);     // Tree position(200,20,200)
-	//glm::vec3 up(0.0f, 1.0f, 0.0f);
-	glm::vec3 lookDir = glm::normalize(cameraPos - objectPos); // Calculate billboard orientation
-	glm::vec3 right = glm::normalize(glm::cross(cameraUp, lookDir));
-	glm::vec3 newUp = glm::cross(lookDir, right);
-	glm::mat4 model = glm::mat4(1.0f);
-	model = glm::translate(model, objectPos);
-	model[0] = glm::vec4(right, 0.0f);
-	model[1] = glm::vec4(newUp, 0.0f);
-	model[2] = glm::vec4(lookDir, 0.0f);
-    return model;
-}
-void TrainView::drawModel(Model* model, Shader* shader, int tex_index, GLfloat projection[16], GLfloat view[16], glm::mat4 mat) {
+void TrainView::drawModel(Model* model, Shader* shader, int tex_index, GLfloat projection[16], GLfloat view[16], glm::mat4 mat, int level) {
 	shader->Use();
-	glActiveTexture(GL_TEXTURE0); // active proper texture unit before binding
-	glUniformMatrix4fv(glGetUniformLocation(shader->Program, "projection"), 1, GL_FALSE, projection);
-	glUniformMatrix4fv(glGetUniformLocation(shader->Program, "view"), 1, GL_FALSE, view);
-	glUniformMatrix4fv(glGetUniformLocation(shader->Program, "model"), 1, GL_FALSE, glm::value_ptr(mat));
-	glUniform1i(glGetUniformLocation(shader->Program, "texture1"), 0);
-	glBindTexture(GL_TEXTURE_2D, tex_index);
-	glActiveTexture(GL_TEXTURE0);
-	model->Draw(*shader);
-	glUseProgram(0);
+	GLState::active_texture(GL_TEXTURE0); // active proper texture unit before binding
+	shader->setMat4(u_projection, projection);
+	shader->setMat4(u_view, view);
+	shader->setMat4(u_model, glm::value_ptr(mat));
+	shader->setInt(u_texture1, 0);
+	GLState::bind_texture(GL_TEXTURE_2D, tex_index);
+	GLState::active_texture(GL_TEXTURE0);
+	model->Draw(*shader, level);
+	GLState::use_program(0);
 }
  
-void drawTreeRecursive(TrainView* tw, float curLength, int branchNum, float downScaleFactor, glm::vec3 curPos, glm::vec3 curScale, glm::vec3 curRotation, int seed) {
-	if (branchNum <= 0 || curLength <= 0) return; // Base case for recursion
-
-	// Create the model matrix
-	glm::mat4 model = glm::mat4(1.0f);
-	model = glm::translate(model, curPos);                         // Translate to current position
-	model = glm::rotate(model, glm::radians(curRotation.x), glm::vec3(1.0f, 0.0f, 0.0f)); // Rotate around X
-	model = glm::rotate(model, glm::radians(curRotation.y), glm::vec3(0.0f, 1.0f, 0.0f)); // Rotate around Y
-	model = glm::rotate(model, glm::radians(curRotation.z), glm::vec3(0.0f, 0.0f, 1.0f)); // Rotate around Z
-	model = glm::scale(model, curScale);                          // Scale the cylinder
-
-	// Pass the model matrix to the shader
-	glUniformMatrix4fv(glGetUniformLocation(tw->trunkShader->Program, "model"), 1, GL_FALSE, glm::value_ptr(model));
-
-	// Draw the current cylinder
-	tw->trunkCylinder->Draw(*tw->trunkShader);
-
-	// Calculate the new position (tip of the current cylinder)
-	glm::vec3 direction = glm::vec3(0.0f, curLength, 0.0f); // Cylinder extends along the Y-axis
-	glm::mat4 rotationMatrix = glm::mat4(1.0f);
-	rotationMatrix = glm::rotate(rotationMatrix, glm::radians(curRotation.x), glm::vec3(1.0f, 0.0f, 0.0f));
-	rotationMatrix = glm::rotate(rotationMatrix, glm::radians(curRotation.y), glm::vec3(0.0f, 1.0f, 0.0f));
-	rotationMatrix = glm::rotate(rotationMatrix, glm::radians(curRotation.z), glm::vec3(0.0f, 0.0f, 1.0f));
-	glm::vec3 rotatedDirection = glm::vec3(rotationMatrix * glm::vec4(direction, 1.0f));
-	glm::vec3 newPos = curPos + rotatedDirection;
-
-	// Update scale and length for the new branches
-	curLength *= downScaleFactor;
-	glm::vec3 newScale = curScale * downScaleFactor;
-
-	// Generate new branches
-	int numBranches = 3; // You can modify this for more branches
-	//radom between 30~50;
-	srand(seed++);
-	float zAngle = rand() % 21 + 30;
-	float yAxisStep = 360.0f / numBranches;
-
-	for (int i = 0; i < numBranches; ++i) {
-		srand(seed++);
-		glm::vec3 newRotation = curRotation;
-		// first incline along z axis
-		newRotation.z += -zAngle / (numBranches - 1);
-        // then rotate along y axis
-		newRotation.y += (yAxisStep * i) + rand() % 21 - 10;//plus a random between -10~10
-
-		// Recursive call for each branch
-		drawTreeRecursive(tw, curLength, branchNum - 1, downScaleFactor, newPos, newScale, newRotation, seed);
-	}
-	//esfera(1.0f, true);
-}
-
-void drawTree(TrainView* tw, int branchNum, GLfloat projection[16], GLfloat view[16], glm::vec3 my_pos, float lightPosition[4], float lightColor[3], int seed) {
+// the tree for seed as one instanced draw, nothing until the worker has grown it
+void drawTree(TrainView* tw, GLfloat projection[16], GLfloat view[16], glm::vec3 my_pos, float lightPosition[4], float lightColor[3], int seed, const glm::mat4& model = glm::mat4(1.0f)) {
+	tw->fractal_tree->request(seed);
+	GLsizei branches = tw->fractal_tree->bind(seed, 0);
+	if (!branches)
+		return;
 	tw->trunkShader->Use();
-	glUniformMatrix4fv(glGetUniformLocation(tw->trunkShader->Program, "projection"), 1, GL_FALSE, projection);
-	glUniformMatrix4fv(glGetUniformLocation(tw->trunkShader->Program, "view"), 1, GL_FALSE, view);
-	glUniformMatrix4fv(glGetUniformLocation(tw->trunkShader->Program, "cameraPos"), 1, GL_FALSE, glm::value_ptr(my_pos));
-	glUniform3fv(glGetUniformLocation(tw->trunkShader->Program, "lightPos"), 1, lightPosition);
-	glUniform3f(glGetUniformLocation(tw->trunkShader->Program, "lightColor"), lightColor[0], lightColor[1], lightColor[2]);
+	tw->trunkShader->setMat4(u_projection, projection);
+	tw->trunkShader->setMat4(u_view, view);
+	tw->trunkShader->setMat4(u_model, glm::value_ptr(model));
+	tw->trunkShader->setVec3(u_cameraPos, my_pos.x, my_pos.y, my_pos.z);
+	tw->trunkShader->setVec3(u_lightPos, lightPosition);
+	tw->trunkShader->setVec3(u_lightColor, lightColor[0], lightColor[1], lightColor[2]);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, tw->trunk_color);
-	glUniform1i(glGetUniformLocation(tw->trunkShader->Program, "albedoMap"), 0);
-	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, tw->trunk_height);
-	glUniform1i(glGetUniformLocation(tw->trunkShader->Program, "heightMap"), 1);
-	glActiveTexture(GL_TEXTURE2);
-	glBindTexture(GL_TEXTURE_2D, tw->trunk_normal);
-	glUniform1i(glGetUniformLocation(tw->trunkShader->Program, "normalMap"), 2);
-	glm::vec3 curPos = glm::vec3(0.0f, 0.0f, 0.0f); // Initial position of
-    glm::vec3 curRotation = glm::vec3(0.0f, 0.0f, 0.0f); // Initial	rotation of the trunk
-    glm::vec3 curScale = glm::vec3(3.0f, 6.0f, 3.0f); //
-	drawTreeRecursive(tw, 18.0f, branchNum, 0.8f, curPos, curScale, curRotation, seed);
+	GLState::active_texture(GL_TEXTURE0);
+	GLState::bind_texture(GL_TEXTURE_2D, tw->trunk_color);
+	tw->trunkShader->setInt(u_albedoMap, 0);
+	GLState::active_texture(GL_TEXTURE1);
+	GLState::bind_texture(GL_TEXTURE_2D, tw->trunk_height);
+	tw->trunkShader->setInt(u_heightMap, 1);
+	GLState::active_texture(GL_TEXTURE2);
+	GLState::bind_texture(GL_TEXTURE_2D, tw->trunk_normal);
+	tw->trunkShader->setInt(u_normalMap, 2);
+	tw->trunkCylinder->DrawInstanced(*tw->trunkShader, branches);
+	GLState::active_texture(GL_TEXTURE0);
 }
 
 //************************************************************************
@@ -345,6 +316,8 @@ void drawTree(TrainView* tw, int branchNum, GLfloat projection[16], GLfloat view
 //========================================================================
 void TrainView::draw()
 {
+	// FlTk may have touched anything since the last frame
+	GLState::frame();
 
 	//*********************************************************************
 	//
@@ -356,16 +329,14 @@ void TrainView::draw()
 	{
 		//initiailize VAO, VBO, Shader...
 		if (!for_model) {
-			for_model = new
-				Shader(
+			for_model = shader_library.add(
 					"./assets/shaders/model_loading.vert",
 					nullptr, nullptr, nullptr,
 					"./assets/shaders/model_loading.frag");
 		}
 
 		if (!for_model_texture) {
-			for_model_texture = new
-				Shader(
+			for_model_texture = shader_library.add(
 					"./assets/shaders/model_texture.vert",
 					nullptr, nullptr, nullptr,
 					"./assets/shaders/model_texture.frag");
@@ -375,11 +346,6 @@ void TrainView::draw()
 		}
 		if (!flower) {
 			flower = new Model("./assets/objects/flower.obj");
-			for (int i = 0; i < flowerNum; i++) {
-				glm::vec3 position = glm::vec3(rand() % 200 - 100, 0, rand() % 200 - 100);
-				flowerPos.push_back(position);
-				aniLength.push_back((double)rand() / ((double)RAND_MAX) / 2.0 + 0.5);//random between 0.5 to 1;
-			}
 		}
 		
 		if (tree_tex == -1) {
@@ -387,83 +353,70 @@ void TrainView::draw()
 		}
 
 		if (!capybara) {
-			capybara = new Model("./assets/objects/capybara.obj");
+			capybara = new Model("./assets/objects/capybara.obj", false, 3);
 		}
 
 		if (capybara_tex == -1) {
 			capybara_tex = TextureFromFile("./assets/objects/Capybara_Base_color.png", ".");
 		}
+		// the props far from the track come with 3 simplified levels, drawn with a few percent of their triangles from afar
 		if (!house1) 
-            house1 = new Model("./assets/objects/house_001.obj");
+            house1 = new Model("./assets/objects/house_001.obj", false, 3);
 		if (!house2) 
-			house2 = new Model("./assets/objects/house_002.obj");
+			house2 = new Model("./assets/objects/house_002.obj", false, 3);
 		if (!house3) 
-			house3 = new Model("./assets/objects/house_003.obj");
+			house3 = new Model("./assets/objects/house_003.obj", false, 3);
 		if (fantasyTexture == -1) 
             fantasyTexture = TextureFromFile("./assets/objects/Texture_fantasy.png", ".");
 		//if(!ferris)
             //ferris = new Model("./assets/objects/ferris_wheel_low_poly.glb");
 
 		if (!dissolve) {
-			dissolve = new Shader(
+			dissolve = shader_library.add(
 				"./assets/shaders/dissolve.vert",
 				nullptr, nullptr, nullptr,
 				"./assets/shaders/dissolve.frag");
 		}
 
-		if (!this->screen) {
-			this->screen = new
-				Shader(
-					"./assets/shaders/screen.vert",
-					nullptr, nullptr, nullptr,
-					"./assets/shaders/screen.frag");
-
-			float quadVertices[] = { // vertex attributes for a quad that fills the entire screen in Normalized Device Coordinates.
-				// positions   // texCoords
-				-1.0f,  1.0f,  0.0f, 1.0f,
-				-1.0f, -1.0f,  0.0f, 0.0f,
-				 1.0f, -1.0f,  1.0f, 0.0f,
-
-				-1.0f,  1.0f,  0.0f, 1.0f,
-				 1.0f, -1.0f,  1.0f, 0.0f,
-				 1.0f,  1.0f,  1.0f, 1.0f
-			};
-			// screen quad VAO
-			glGenVertexArrays(1, &screen_quadVAO);
-			glGenBuffers(1, &screen_quadVBO);
-			glBindVertexArray(screen_quadVAO);
-			glBindBuffer(GL_ARRAY_BUFFER, screen_quadVBO);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
-			glEnableVertexAttribArray(0);
-			glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-			glEnableVertexAttribArray(1);
-			glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-
-			screen->Use();
-			glUniform1i(glGetUniformLocation(screen->Program, "screenTexture"), 0);
-
-			glGenFramebuffers(1, &screen_framebuffer);
-			glBindFramebuffer(GL_FRAMEBUFFER, screen_framebuffer);
-
-			glGenTextures(1, &screen_textureColorbuffer);
-			glBindTexture(GL_TEXTURE_2D, screen_textureColorbuffer);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w(), h(), 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, screen_textureColorbuffer, 0);
-
-			glGenRenderbuffers(1, &screen_rbo);
-			glBindRenderbuffer(GL_RENDERBUFFER, screen_rbo);
-			glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, w(), h()); // use a single renderbuffer object for both a depth AND stencil buffer.
-			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, screen_rbo); // now actually attach it
-			// now that we actually created the framebuffer and added all attachments we want to check if it is actually complete now
-			if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-				cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << endl;
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		if (!post_process) {
+			render_targets = new RenderTargetPool();
+			gpu_timer = new GpuTimer();
+			post_process = new PostProcess();
+			// one program per effect, in the order they are applied. fxaa goes last so it smooths whatever came before it
+			const char* vert = "./assets/shaders/screen.vert";
+			// brings a scene drawn below window size back up before any effect sees it
+			post_process->add("upscale", shader_library.add(vert, nullptr, nullptr, nullptr, "./assets/shaders/post_upscale.frag"), 1.0f,
+				[this](Shader* shader) {
+					shader->setVec2(u_uv_scale, scene_uv_scale.x, scene_uv_scale.y);
+					shader->setFloat(u_sharpness, 1.0f - render_scale);
+				});
+			velocity_shader = shader_library.add(vert, nullptr, nullptr, nullptr, "./assets/shaders/post_velocity.frag");
+			post_process->add("motion blur", shader_library.add(vert, nullptr, nullptr, nullptr, "./assets/shaders/post_motion_blur.frag"), 1.0f,
+				[this](Shader* shader) {
+					shader->setInt(u_velocityTexture, 1);
+					shader->setInt(u_samples, motion_blur_samples);
+					shader->setFloat(u_strength, motion_blur_strength);
+					GLState::active_texture(GL_TEXTURE1);
+					GLState::bind_texture(GL_TEXTURE_2D, velocity_texture);
+				});
+			post_process->add("pixel", shader_library.add(vert, nullptr, nullptr, nullptr, "./assets/shaders/post_pixel.frag"));
+			post_process->add("offset", shader_library.add(vert, nullptr, nullptr, nullptr, "./assets/shaders/post_offset.frag"));
+			post_process->add("sobel", shader_library.add(vert, nullptr, nullptr, nullptr, "./assets/shaders/post_sobel.frag"));
+			post_process->add("toon", shader_library.add(vert, nullptr, nullptr, nullptr, "./assets/shaders/post_toon.frag"));
+			post_process->add("sharpen", shader_library.add(vert, nullptr, nullptr, nullptr, "./assets/shaders/post_sharpen.frag"));
+			post_process->add("ascii", shader_library.add(vert, nullptr, nullptr, nullptr, "./assets/shaders/post_ascii.frag"));
+			// twelve wide taps of an already blurry image, half resolution is plenty
+			post_process->add("chromaticAberration", shader_library.add(vert, nullptr, nullptr, nullptr, "./assets/shaders/post_chromatic.frag"), 0.5f);
+			post_process->add("fxaa", shader_library.add(vert, nullptr, nullptr, nullptr, "./assets/shaders/post_fxaa.frag"), 1.0f,
+				[](Shader* shader) {
+					shader->setFloat(u_lumaThreshold, 0.5f);
+					shader->setFloat(u_mulReduce, 1.0f / 8.0f);
+					shader->setFloat(u_minReduce, 1.0f / 128.0f);
+					shader->setFloat(u_maxSpan, 8.0f);
+				});
 		}
 		if (!this->skybox) {
-			this->skybox = new
-				Shader(
+			this->skybox = shader_library.add(
 					"./assets/shaders/skybox.vert",
 					nullptr, nullptr, nullptr,
 					"./assets/shaders/skybox.frag");
@@ -514,7 +467,7 @@ void TrainView::draw()
 			// skybox VAO
 			glGenVertexArrays(1, &skyboxVAO);
 			glGenBuffers(1, &skyboxVBO);
-			glBindVertexArray(skyboxVAO);
+			GLState::bind_vertex_array(skyboxVAO);
 			glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
 			glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
 			glEnableVertexAttribArray(0);
@@ -529,47 +482,51 @@ void TrainView::draw()
 			};
 			skyBoxCubemapTexture = loadCubemap(faces);
 		}
-		//Load billboard tree
-		
-		if (!this->billboardTree) {
-			this->billboardTree = new Shader(
-                "./assets/shaders/billboardTree.vert",
+		//Load impostors, they are baked once the programs are linked
+		if (!impostorShader) {
+			impostorShader = shader_library.add(
+				"./assets/shaders/impostor.vert",
 				nullptr, nullptr, nullptr,
-            "./assets/shaders/billboardTree.frag");
-			float quadVertices[] = {
-				// Positions         // Texture Coordinates
-				-0.5f,  1.0f, 0.0f,  0.0f, 1.0f,  // Top-left
-				 0.5f,  1.0f, 0.0f,  1.0f, 1.0f,  // Top-right
-				 0.5f, -1.0f, 0.0f,  1.0f, 0.0f,  // Bottom-right
-				-0.5f, -1.0f, 0.0f,  0.0f, 0.0f   // Bottom-left
-			};
-			unsigned int indices[] = {
-				0, 1, 2,  // First triangle
-				0, 2, 3   // Second triangle
-			};
-			glGenVertexArrays(1, &billboardtree_quadVAO);
-			glGenBuffers(1, &billboardtree_quadVBO);
-			glGenBuffers(1, &billboardtree_quadEBO);
-
-			glBindVertexArray(billboardtree_quadVAO);
-			glBindBuffer(GL_ARRAY_BUFFER, billboardtree_quadVBO);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
-
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, billboardtree_quadEBO);
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-			// Position Attribute
-			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-			glEnableVertexAttribArray(0);
-			// Texture Coordinate Attribute
-			glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-			glEnableVertexAttribArray(1);
+				"./assets/shaders/impostor.frag");
+			impostorBake = shader_library.add(
+				"./assets/shaders/impostor_bake.vert",
+				nullptr, nullptr, nullptr,
+				"./assets/shaders/impostor_bake.frag");
+			tree_impostor = new Impostor(*tree, impostorBake, tree_tex);
+			std::array<Model*, 3> house_models = { house1, house2, house3 };
+			for (int i = 0; i < 3; i++)
+				house_impostors[i] = new Impostor(*house_models[i], impostorBake, fantasyTexture);
+		}
 
-			billboardTreeTexture = TextureFromFile("/assets/images/tree_upsidedown.png", ".");
+		// flowers and trees over the whole floor, the red channel of the density map places flowers and the green one trees
+		if (!vegetation) {
+			tree_instanced = shader_library.add(
+				"./assets/shaders/model_texture.vert",
+				nullptr, nullptr, nullptr,
+				"./assets/shaders/model_texture.frag",
+				Shader::Defines{ "INSTANCED" });
+			vegetation = new Vegetation();
+			vegetation->add("flowers", flower, dissolve, [this](Shader* shader) {
+				shader->setMat4(u_projection, glm::value_ptr(camera.projection));
+				shader->setMat4(u_view, glm::value_ptr(camera.view));
+				shader->setFloat(u_time, timeElapsed);
+				shader->setInt(u_diffuseTexture, 0);
+				GLState::active_texture(GL_TEXTURE0);
+				GLState::bind_texture(GL_TEXTURE_2D, tree_tex);
+			}, 0, 400, glm::vec2(4.0f, 6.0f), 80.0f, 80.0f);
+			vegetation->add("trees", tree, tree_instanced, [this](Shader* shader) {
+				shader->setMat4(u_projection, glm::value_ptr(camera.projection));
+				shader->setMat4(u_view, glm::value_ptr(camera.view));
+				shader->setInt(u_texture1, 0);
+				GLState::active_texture(GL_TEXTURE0);
+				GLState::bind_texture(GL_TEXTURE_2D, tree_tex);
+			}, 1, 8, glm::vec2(3.5f, 5.0f), 150.0f, 1000.0f, tree_impostor);
+			vegetation->scatter("./assets/images/vegetation_density.png");
 		}
 		
 		//Load projector (project texture with texture matrix)
 		if (!projectorShader) {
-			this->projectorShader = new Shader(
+			this->projectorShader = shader_library.add(
 				"./assets/shaders/projector.vert",
 				nullptr, nullptr, nullptr,
 				"./assets/shaders/projector.frag"
@@ -577,16 +534,8 @@ void TrainView::draw()
 			projectorTexture = TextureFromFile("/assets/images/earth.png", ".");
 		}
 
-		if (framebuffer[0] == -1) {
-			for (int i = 0; i < 8; i++) {
-				set_fbo(&framebuffer[i], &textureColorbuffer[i]);
-				glUniform1i(glGetUniformLocation(screen->Program, ("TextureFBO" + to_string(i + 1)).c_str()), i);
-				trans[i] = glm::mat4(1.0f);
-			}
-		}
 		if (!fbo_shader) {
-			fbo_shader = new
-				Shader(
+			fbo_shader = shader_library.add(
 					"./assets/shaders/fbo.vert",
 					nullptr, nullptr, nullptr,
 					"./assets/shaders/fbo.frag");
@@ -595,25 +544,28 @@ void TrainView::draw()
 		}
 
 		if (!rock) {
-			rock = new Model("./assets/objects/rock.obj");
+			rock = new Model("./assets/objects/rock.obj", false, 3);
 			rock_spec = TextureFromFile("/assets/images/rock-spec.png", ".");
 			rock_normal = TextureFromFile("/assets/images/rock-norm.png", ".");
 			rock_diff = TextureFromFile("/assets/images/rock-diff.png", ".");
-			rockShader = new
-				Shader(
+			// the rock is only drawn from the packed static geometry
+			rockShader = shader_library.add(
 					"./assets/shaders/rock.vert",
 					nullptr, nullptr, nullptr,
-					"./assets/shaders/rock.frag");
+					"./assets/shaders/rock.frag",
+					Shader::Defines{ "STATIC" });
 		}
 
 		if (grass == -1) {
 			grass = TextureFromFile("/assets/images/grass-1024x1024.png", ".");
 		}
+		if (!terrain)
+			terrain = new Terrain();
 
 		if (rainSystem == nullptr) {
 			rainTexture = TextureFromFile("/assets/images/rain.png", ".");
 			rainSystem = new RainSystem(150.0f, 150.0f, 1000, 9.0f, rainTexture);
-			rainShader = new Shader(
+			rainShader = shader_library.add(
 				"./assets/shaders/rain.vert",
 				nullptr, nullptr, nullptr,
 				"./assets/shaders/rain.frag");
@@ -624,41 +576,174 @@ void TrainView::draw()
 			trunk_color = TextureFromFile("/assets/images/wood_0025_color_1k.jpg", ".");
 			trunk_height = TextureFromFile("/assets/images/wood_0025_height_1k.png", ".");
 			trunk_normal = TextureFromFile("/assets/images/wood_0025_normal_opengl_1k.png", ".");
-			trunkShader = new Shader(
+			trunkShader = shader_library.add(
 				"./assets/shaders/trunk.vert",
 				nullptr, nullptr, nullptr,
 				"./assets/shaders/trunk.frag");
 		}
+
+		if (!fractal_tree)
+			fractal_tree = new FractalTree();
+
+		// the world as a tree of nodes with boxes from their meshes, the visible ones queue their draws
+		// and the queue runs them sorted by program and texture, see RenderQueue
+		if (!scene_graph) {
+			// the houses and the rock share one vertex and one index buffer, each program draws its part with one call
+			static_model_texture = shader_library.add(
+				"./assets/shaders/model_texture.vert",
+				nullptr, nullptr, nullptr,
+				"./assets/shaders/model_texture.frag",
+				Shader::Defines{ "STATIC" });
+			static_geometry = new StaticGeometry();
+			std::array<Model*, 3> house_models = { house1, house2, house3 };
+			std::array<int, 3> house_objects;
+			for (int i = 0; i < 3; i++)
+				house_objects[i] = static_geometry->add(*house_models[i]);
+			int rock_object = static_geometry->add(*rock);
+			static_geometry->build();
+			int house_batch = static_geometry->batch(), rock_batch = static_geometry->batch();
+
+			render_queue = new RenderQueue();
+			// shared by every draw of the program, set once a frame
+			render_queue->program(static_model_texture, [this](Shader* shader) {
+				shader->setMat4(u_projection, glm::value_ptr(camera.projection));
+				shader->setMat4(u_view, glm::value_ptr(camera.view));
+				shader->setInt(u_texture1, 0);
+			});
+			render_queue->program(rockShader, [this](Shader* shader) {
+				shader->setMat4(u_projection, glm::value_ptr(camera.projection));
+				shader->setMat4(u_view, glm::value_ptr(camera.view));
+				shader->setVec3(u_viewPos, camera.position.x, camera.position.y, camera.position.z);
+				shader->setVec3(u_lightPos, lightPosition);
+				shader->setFloat(u_lightIntensity, lightStrength / 5.0f);
+				shader->setVec3(u_lightColor, lightColor[0], lightColor[1], lightColor[2]);
+				shader->setInt(u_specularMap, 0);
+				shader->setInt(u_normalMap, 1);
+				shader->setInt(u_diffuseMap, 2);
+			});
+			render_queue->program(impostorShader, [this](Shader* shader) {
+				shader->setMat4(u_projection, glm::value_ptr(camera.projection));
+				shader->setMat4(u_view, glm::value_ptr(camera.view));
+				shader->setVec3(u_cameraPos, camera.position.x, camera.position.y, camera.position.z);
+			});
+			render_queue->program(skybox, [this](Shader* shader) {
+				glm::mat4 view_without_translate = glm::mat4(glm::mat3(camera.view));
+				shader->setFloat(u_skybox, skyBoxCubemapTexture);
+				shader->setMat4(u_projection, glm::value_ptr(camera.projection));
+				shader->setMat4(u_model_view, &view_without_translate[0][0]);
+			});
+
+			scene_graph = new SceneGraph();
+			// flowers and trees cull their own cells and draw with their own programs
+			scene_graph->root.add(new SceneNode("vegetation", [this](const SceneNode&, RenderQueue& queue) {
+				queue.submit(RenderQueue::PASS_OPAQUE, nullptr, 0, 0.0f, [this](Shader*) {
+					vegetation->draw(camera, tw->floornoise->value(), impostorShader);
+				});
+			}));
+
+			// the group draws the batch its visible houses were put into
+			SceneNode* houses = scene_graph->root.add(new SceneNode("houses", [this, house_batch](const SceneNode& node, RenderQueue& queue) {
+				queue.submit(RenderQueue::PASS_OPAQUE, static_model_texture, fantasyTexture, glm::distance(camera.position, node.center()), [this, house_batch](Shader*) {
+					static_geometry->draw(house_batch);
+				});
+			}));
+			std::array<glm::vec3, 3> house_positions = { glm::vec3(-100, 0, 70), glm::vec3(+100, 0, 30), glm::vec3(-60, 0, -110) };
+			// further than this a house is only its impostor's two triangles
+			const float impostor_distance = 250.0f;
+			for (int i = 0; i < 3; i++) {
+				Model* house = house_models[i];
+				Impostor* impostor = house_impostors[i];
+				int object = house_objects[i];
+				// the level is kept from frame to frame for the hysteresis
+				SceneNode* node = houses->add(new SceneNode("house" + std::to_string(i + 1), [this, house, impostor, impostor_distance, house_batch, object, level = 0](const SceneNode& node, RenderQueue& queue) mutable {
+					float distance = glm::distance(camera.position, node.center());
+					if (distance > impostor_distance) {
+						impostor->queue(node.world);
+						queue.submit(RenderQueue::PASS_OPAQUE, impostorShader, impostor->albedo, distance, [impostor](Shader* shader) {
+							impostor->draw(shader);
+						});
+						return;
+					}
+					level = house->lod(camera.screen_size(node.center(), node.radius()), level);
+					static_geometry->queue(house_batch, object, node.world, level);
+				}));
+				node->local = getTransformMatrix(glm::mat4(1.0f), house_positions[i], glm::vec3(10, 10, 10), glm::vec3(0, 1, 0), -90);
+				node->bounds(house->low, house->high);
+			}
+
+			rock_node = scene_graph->root.add(new SceneNode("rock", [this, rock_batch, rock_object, level = 0](const SceneNode& node, RenderQueue& queue) mutable {
+				level = rock->lod(camera.screen_size(node.center(), node.radius()), level);
+				static_geometry->queue(rock_batch, rock_object, node.world, level);
+				queue.submit(RenderQueue::PASS_OPAQUE, rockShader, rock_spec, glm::distance(camera.position, node.center()), [this, rock_batch](Shader*) {
+					GLState::active_texture(GL_TEXTURE1);
+					GLState::bind_texture(GL_TEXTURE_2D, rock_normal);
+					GLState::active_texture(GL_TEXTURE2);
+					GLState::bind_texture(GL_TEXTURE_2D, rock_diff);
+					static_geometry->draw(rock_batch);
+				});
+			}));
+			rock_node->local = getTransformMatrix(glm::mat4(1.0f), glm::vec3(0, 5, 0), glm::vec3(15, 15, 15), glm::vec3(0, 1, 0), 0);
+			rock_node->bounds(rock->low, rock->high);
+
+			fractal_tree_node = scene_graph->root.add(new SceneNode("fractal tree", [this](const SceneNode& node, RenderQueue& queue) {
+				const glm::mat4& model = node.world;
+				queue.submit(RenderQueue::PASS_OPAQUE, nullptr, 0, glm::distance(camera.position, node.center()), [this, &model](Shader*) {
+					drawTree(this, glm::value_ptr(camera.projection), glm::value_ptr(camera.view), camera.position, lightPosition, lightColor, randSeed, model);
+				});
+			}));
+			glm::vec3 tree_low, tree_high;
+			fractal_tree->bounds(tree_low, tree_high);
+			fractal_tree_node->bounds(tree_low, tree_high);
+
+			scene_graph->root.add(new SceneNode("skybox", [this](const SceneNode&, RenderQueue& queue) {
+				queue.submit(RenderQueue::PASS_SKY, skybox, 0, 0.0f, [this](Shader*) {
+					GLState::disable(GL_CULL_FACE);
+					GLState::depth_func(GL_LEQUAL);
+					GLState::bind_vertex_array(skyboxVAO);
+					GLState::active_texture(GL_TEXTURE0);
+					GLState::bind_texture(GL_TEXTURE_CUBE_MAP, skyBoxCubemapTexture);
+					glDrawArrays(GL_TRIANGLES, 0, 36);
+					GLState::bind_vertex_array(0);
+					GLState::depth_func(GL_LESS); // set depth function back to default
+				});
+			}));
+
+			// the drops only fall while someone looks at them
+			SceneNode* rain = scene_graph->root.add(new SceneNode("rain", [this](const SceneNode& node, RenderQueue& queue) {
+				queue.submit(RenderQueue::PASS_TRANSPARENT, nullptr, 0, glm::distance(camera.position, node.center()), [this](Shader*) {
+					rainSystem->update(1.0f / 30.0f);
+					rainSystem->render(glm::value_ptr(camera.view), glm::value_ptr(camera.projection), rainShader);
+				});
+			}));
+			rain->bounds(glm::vec3(-75.0f, -0.5f, -75.0f), glm::vec3(75.0f, 70.0f, 75.0f));
+
+			scene_graph->update();
+		}
 	}
 	else
 		throw std::runtime_error("Could not initialize GLAD!");
 
+	// the programs above were only submitted, show an empty frame until the driver has linked all of them
+	if (!shaders_ready) {
+		if (!shader_library.ready()) {
+			glClearColor(0, 0, .3f, 0);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			Fl::add_timeout(0.01, [](void* view) { ((TrainView*)view)->redraw(); }, this);
+			return;
+		}
+		shaders_ready = true;
+		tree_impostor->bake();
+		for (Impostor* impostor : house_impostors)
+			impostor->bake();
+	}
+
 	//######################################################################
 	//This is where assets loading end
 	//######################################################################
 
-	static int pre_w = w(), pre_h = h();
-	// Set up the view port
-	glViewport(0, 0, w(), h());
-	if (pre_w != w() || pre_h != h()) {
-		glBindFramebuffer(GL_FRAMEBUFFER, screen_framebuffer);
-
-		glBindTexture(GL_TEXTURE_2D, screen_textureColorbuffer);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w(), h(), 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, screen_textureColorbuffer, 0);
-
-		glBindRenderbuffer(GL_RENDERBUFFER, screen_rbo);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, w(), h()); // use a single renderbuffer object for both a depth AND stencil buffer.
-		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, screen_rbo); // now actually attach it
-		// now that we actually created the framebuffer and added all attachments we want to check if it is actually complete now
-		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-			cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << endl;
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	}
-	pre_w = w();
-	pre_h = h();
+	// targets nobody used last frame (old window sizes, effects turned off) are freed here
+	render_targets->frame();
+	gpu_timer->begin();
 
 	// Set up the view port
 	glViewport(0, 0, w(), h());
@@ -670,7 +755,6 @@ void TrainView::draw()
 	// it for shadows
 	glClearStencil(0);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-	glEnable(GL_DEPTH);
 
 	// Blayne prefers GL_DIFFUSE
 	glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
@@ -686,27 +770,27 @@ void TrainView::draw()
 	// we need to set up the lights AFTER setting up the projection
 	//######################################################################
 	// enable the lighting
-	glEnable(GL_COLOR_MATERIAL);
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_LIGHTING);
-	glEnable(GL_LIGHT0);
+	GLState::enable(GL_COLOR_MATERIAL);
+	GLState::enable(GL_DEPTH_TEST);
+	GLState::enable(GL_LIGHTING);
+	GLState::enable(GL_LIGHT0);
 
 	// top view only needs one light
 	if (tw->topCam->value()) {
-		glDisable(GL_LIGHT1);
-		glDisable(GL_LIGHT2);
+		GLState::disable(GL_LIGHT1);
+		GLState::disable(GL_LIGHT2);
 	}
 	else {
-		glEnable(GL_LIGHT1);
-		glEnable(GL_LIGHT2);
+		GLState::enable(GL_LIGHT1);
+		GLState::enable(GL_LIGHT2);
 	}
-	glEnable(GL_LIGHTING);
-	glEnable(GL_LIGHT0);
-	glEnable(GL_LIGHT1);
+	GLState::enable(GL_LIGHTING);
+	GLState::enable(GL_LIGHT0);
+	GLState::enable(GL_LIGHT1);
 	if (tw->trainCam->value() || !tw->headlight->value()) {
-		glDisable(GL_LIGHT3);
+		GLState::disable(GL_LIGHT3);
 	}else {
-		glEnable(GL_LIGHT3);
+		GLState::enable(GL_LIGHT3);
 	}
 
 	/*
@@ -722,7 +806,7 @@ void TrainView::draw()
 		glLightfv(GL_LIGHT0, GL_POSITION, lightPosition);
 	}
 	else {
-		glDisable(GL_LIGHT0);
+		GLState::disable(GL_LIGHT0);
 	}
 	*/
 	//*********************************************************************
@@ -730,10 +814,9 @@ void TrainView::draw()
 	// * set the light parameters
 	//
 	//**********************************************************************
-	float lightPosition[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	lightPosition[0] = lightPosition[1] = lightPosition[2] = lightPosition[3] = 0.0f;
 	float PI = 3.1415926f;
-	float strength = 2.5f;
-	float lightColor[3];
+	lightStrength = 2.5f;
 	if (tw->pointlight->value()) {
 		lightColor[0] = tw->lightR->value(); lightColor[1] = tw->lightG->value(); lightColor[2] = tw->lightB->value();
 	}
@@ -742,22 +825,22 @@ void TrainView::draw()
 	}
 	if (tw->pointlight->value()) {
 		// Enable only the point light
-		strength = tw->brightness->value();
-		float Ambient[] = { lightColor[0] * strength,  lightColor[1] * strength, lightColor[2] * strength, 1.0f }; // Scale red ambient by strength
-		float Diffuse[] = { lightColor[0] * strength, lightColor[1] * strength, lightColor[2] * strength, 1.0f }; // Scale red diffuse by strength
+		lightStrength = tw->brightness->value();
+		float Ambient[] = { lightColor[0] * lightStrength,  lightColor[1] * lightStrength, lightColor[2] * lightStrength, 1.0f }; // Scale red ambient by strength
+		float Diffuse[] = { lightColor[0] * lightStrength, lightColor[1] * lightStrength, lightColor[2] * lightStrength, 1.0f }; // Scale red diffuse by strength
 		float angle = tw->lightangle->value();
 		float radius = tw->lightradius->value();
 		lightPosition[0] = radius * cos(angle);
 		lightPosition[1] = 20.0f;
 		lightPosition[2] = radius * sin(angle);
 		lightPosition[3] = 1.0f; // Positional light
-		glEnable(GL_LIGHT1);// Set the point light properties
+		GLState::enable(GL_LIGHT1);// Set the point light properties
 		glLightfv(GL_LIGHT1, GL_AMBIENT, Ambient);
 		glLightfv(GL_LIGHT1, GL_DIFFUSE, Diffuse);
 		glLightfv(GL_LIGHT1, GL_POSITION, lightPosition);
 		// Disable the other lights
-		glDisable(GL_LIGHT0);
-		glDisable(GL_LIGHT2);
+		GLState::disable(GL_LIGHT0);
+		GLState::disable(GL_LIGHT2);
 	}
 	else {
 		// Enable the complex light setup
@@ -768,32 +851,26 @@ void TrainView::draw()
 	GLfloat whiteLight[] = { 1.0f, 1.0f, 1.0f, 1.0f };
 	GLfloat blueLight[] = { 0.1f, 0.1f, 0.3f, 1.0f };
 	GLfloat grayLight[] = { 0.3f, 0.3f, 0.3f, 1.0f };
-	glEnable(GL_LIGHT0);// Configure the first light
+	GLState::enable(GL_LIGHT0);// Configure the first light
 	glLightfv(GL_LIGHT0, GL_POSITION, lightPosition1);
 	glLightfv(GL_LIGHT0, GL_DIFFUSE, whiteLight);
 	glLightfv(GL_LIGHT0, GL_AMBIENT, grayLight);
-	glEnable(GL_LIGHT1);// Configure the second light
+	GLState::enable(GL_LIGHT1);// Configure the second light
 	glLightfv(GL_LIGHT1, GL_POSITION, lightPosition2);
 	glLightfv(GL_LIGHT1, GL_DIFFUSE, yellowLight);
 	glLightfv(GL_LIGHT1, GL_AMBIENT, grayLight);
-	glEnable(GL_LIGHT2);// Configure the third light
+	GLState::enable(GL_LIGHT2);// Configure the third light
 	glLightfv(GL_LIGHT2, GL_POSITION, lightPosition3);
 	glLightfv(GL_LIGHT2, GL_DIFFUSE, blueLight);
 	// Disable the point light
-	glDisable(GL_LIGHT1);
+	GLState::disable(GL_LIGHT1);
 	lightPosition[0] = lightPosition[2] = lightPosition[3] = 0.0f;
 	lightPosition[1] = 500.f;//the light simulate light of daytime, which is viewed by shaders as at high postion.
 	}
 
 	//view and projection matrix setup
-	GLfloat projection[16];
-	GLfloat view[16];
-	glGetFloatv(GL_PROJECTION_MATRIX, projection);
-	glGetFloatv(GL_MODELVIEW_MATRIX, view);
-	glm::mat4 view_without_translate = glm::mat4(glm::mat3(glm::make_mat4(view)));
-	glm::mat4 view_inv = glm::inverse(glm::make_mat4(view));
-	glm::vec3 my_pos(view_inv[3][0], view_inv[3][1], view_inv[3][2]);
-	glm::mat4 model = glm::mat4(1.0f);
+	GLfloat* projection = glm::value_ptr(camera.projection);
+	GLfloat* view = glm::value_ptr(camera.view);
 
 	//projector setup start
 	if (tw->projector->value()) {
@@ -807,22 +884,34 @@ void TrainView::draw()
 		glMultMatrixf(projection);
 		glMultMatrixf(view);// Apply the camera's view matrix
 		glMatrixMode(GL_MODELVIEW);// Return to modelview matrix mode
-		glEnable(GL_TEXTURE_2D);
-		glBindTexture(GL_TEXTURE_2D, projectorTexture);// Enable texture generation for projection
+		GLState::enable(GL_TEXTURE_2D);
+		GLState::bind_texture(GL_TEXTURE_2D, projectorTexture);// Enable texture generation for projection
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 		glTexGeni(GL_S, GL_TEXTURE_GEN_MODE, GL_EYE_LINEAR);
 		glTexGeni(GL_T, GL_TEXTURE_GEN_MODE, GL_EYE_LINEAR);
-		glEnable(GL_TEXTURE_GEN_S);
-		glEnable(GL_TEXTURE_GEN_T);
+		GLState::enable(GL_TEXTURE_GEN_S);
+		GLState::enable(GL_TEXTURE_GEN_T);
 	}
 	else {
-		glUseProgram(0);
+		GLState::use_program(0);
 	}
 	//projector setup end
 
 
-	glBindFramebuffer(GL_FRAMEBUFFER, screen_framebuffer);
+	// line 1 of the list is "default", every other line is the pass of the same name
+	for (int i = 2; i <= tw->framebuffer->size(); i++)
+		post_process->enable(tw->framebuffer->text(i), tw->framebuffer->selected(i) != 0);
+	// the scene may only fill the lower left part of a full size target, see update_render_scale()
+	int scene_w = (std::max)(1, (int)(w() * render_scale)), scene_h = (std::max)(1, (int)(h() * render_scale));
+	scene_uv_scale = glm::vec2((float)scene_w / w(), (float)scene_h / h());
+	post_process->enable("upscale", scene_w != w() || scene_h != h());
+	// without any effect the scene goes straight to the window, no offscreen copy
+	RenderTargetPool::Target* scene = nullptr;
+	if (post_process->active())
+		scene = render_targets->acquire({ w(), h(), GL_RGB8, GL_DEPTH24_STENCIL8 });
+	GLState::bind_framebuffer(GL_FRAMEBUFFER, scene ? scene->fbo : 0);
+	glViewport(0, 0, scene_w, scene_h);
 	// make sure we clear the framebuffer's content
 	glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -832,197 +921,88 @@ void TrainView::draw()
 	// set to opengl fixed pipeline(use opengl 1.x draw function)
 	
 
+	// the 3DUtils helpers switch state with plain gl calls, GLState has to forget what it knew after each of them
 	setupFloor();
+	GLState::invalidate();
 	//glDisable(GL_LIGHTING);
-	drawFloor(500, 50, grass, tw->floornoise->value());
+	terrain->draw(500, 50, grass, tw->floornoise->value());
 
 
 	//*********************************************************************
 	// now draw the object and we need to do it twice
 	// once for real, and then once for shadows
 	//*********************************************************************
-	glEnable(GL_LIGHTING);
+	GLState::enable(GL_LIGHTING);
 	setupObjects();
+	GLState::invalidate();
 
 	drawStuff();
 
 	// this time drawing is for shadows (except for top view)
 	if (!tw->topCam->value()) {
 		setupShadows();
+		GLState::invalidate();
 		drawStuff(true);
 		unsetupShadows();
+		GLState::invalidate();
 	}
 
 	//draw tree model
 	//model = getTransformMatrix(model, glm::vec3(0, 0, 0), glm::vec3(2, 2, 2), glm::vec3(0, 1, 0), 0);
 	//drawModel(tree, for_model_texture, tree_tex, projection, view, model);
 
-	//draw flower model
-	int flowerNum = 25;
-	dissolve->Use();
-	glActiveTexture(GL_TEXTURE0); // active proper texture unit before binding
-	glUniformMatrix4fv(glGetUniformLocation(dissolve->Program, "projection"), 1, GL_FALSE, projection);
-	glUniformMatrix4fv(glGetUniformLocation(dissolve->Program, "view"), 1, GL_FALSE, view);
-	glUniform1i(glGetUniformLocation(dissolve->Program, "diffuseTexture"), 0);
-	glBindTexture(GL_TEXTURE_2D, tree_tex);
-	glActiveTexture(GL_TEXTURE0);
-	
-	
+	//draw flowers and trees, houses, the center object, skybox and rain, whatever the camera can see of them
 	timeElapsed += 1.0f / 30.0f;
-	for (int i = 0; i < flowerNum; i++) {
-		model = getTransformMatrix(model, flowerPos[i], glm::vec3(5, 5, 5), glm::vec3(0, 1, 0), 0);
-		glUniformMatrix4fv(glGetUniformLocation(dissolve->Program, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		float factor = 0.5 * (aniLength[i] + sin(1.0f * timeElapsed));
-		glUniform1f(glGetUniformLocation(dissolve->Program, "dissolveFactor"), factor);
-
-		flower->Draw(*dissolve);	
+	rock_node->enabled = tw->centerObject->value() == 2;
+	fractal_tree_node->enabled = tw->centerObject->value() == 3;
+	if (rock_node->enabled && created) {
+		randSeed++;
+		created = false;
 	}
-	glUseProgram(0);
-
-	//drawModel(flower, for_model_texture, tree_tex, projection, view, model);
-
-	model = getTransformMatrix(model, glm::vec3(-100, 0, 70), glm::vec3(10, 10, 10), glm::vec3(0, 1, 0), -90);
-	drawModel(house1, for_model_texture, fantasyTexture, projection, view, model);
-
-	model = getTransformMatrix(model, glm::vec3(+100, 0, 30), glm::vec3(10, 10, 10), glm::vec3(0, 1, 0), -90);
-	drawModel(house2, for_model_texture, fantasyTexture, projection, view, model);
-
-	model = getTransformMatrix(model, glm::vec3(-60, 0, -110), glm::vec3(10, 10, 10), glm::vec3(0, 1, 0), -90);
-	drawModel(house3, for_model_texture, fantasyTexture, projection, view, model);
-
-	
-
-	//draw rock model
-	if (tw->centerObject->value() == 2) {
-		rockShader->Use();
-		model = getTransformMatrix(model, glm::vec3(0, 5, 0), glm::vec3(15, 15, 15), glm::vec3(0, 1, 0), 0);
-		glUniformMatrix4fv(glGetUniformLocation(rockShader->Program, "projection"), 1, GL_FALSE, projection);
-		glUniformMatrix4fv(glGetUniformLocation(rockShader->Program, "view"), 1, GL_FALSE, view);
-		glUniformMatrix4fv(glGetUniformLocation(rockShader->Program, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glUniformMatrix4fv(glGetUniformLocation(rockShader->Program, "viewPos"), 1, GL_FALSE, glm::value_ptr(my_pos));
-		glUniform3fv(glGetUniformLocation(rockShader->Program, "lightPos"), 1, lightPosition);
-		glUniform1f(glGetUniformLocation(rockShader->Program, "lightIntensity"), strength / 5.0f);
-		glUniform3f(glGetUniformLocation(rockShader->Program, "lightColor"), lightColor[0], lightColor[1], lightColor[2]);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, rock_spec);
-		glUniform1i(glGetUniformLocation(rockShader->Program, "specularMap"), 0);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, rock_normal);
-		glUniform1i(glGetUniformLocation(rockShader->Program, "normalMap"), 1);
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, rock_diff);
-		glUniform1i(glGetUniformLocation(rockShader->Program, "diffuseMap"), 2);
-		rock->Draw(*rockShader);
-		if (created) {
-			randSeed++;
-			created = false;
-		}
+	if (fractal_tree_node->enabled) {
+		// grow the next one already, so switching back shows a new tree right away
+		fractal_tree->request(randSeed + 1);
+		created = true;
 	}
-	else if (tw->centerObject->value() == 3) {
-		drawTree(this, 7, projection, view, my_pos, lightPosition, lightColor, randSeed);
-        created = true;
-	} 
-	//cout << tw->centerObject->value() << endl;
-	//draw skybox section start
-	glDisable(GL_CULL_FACE);
-	glDepthFunc(GL_LEQUAL);
-	skybox->Use();
-	glUniform1f(glGetUniformLocation(skybox->Program, "skybox"), skyBoxCubemapTexture);
-	glUniformMatrix4fv(glGetUniformLocation(skybox->Program, "projection"), 1, GL_FALSE, projection);
-	glUniformMatrix4fv(glGetUniformLocation(skybox->Program, "model_view"), 1, GL_FALSE, &view_without_translate[0][0]);
-	glBindVertexArray(skyboxVAO);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, skyBoxCubemapTexture);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
-	glDepthFunc(GL_LESS); // set depth function back to default
-	//draw skybox section end
-	// ******************************************************************************************************************
-	//draw billboard tree start
-	//model = billBoardModel(glm::vec3(200, 20, -200), my_pos, glm::vec3(0, 1, 0));
-	//model = glm::scale(model, glm::vec3(25.0f, 25.0f, 25.0f));
-
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-	glDepthMask(GL_FALSE); // setting start
-	billboardTree->Use();
-	glUniform1f(glGetUniformLocation(billboardTree->Program, "billboardTree"), billboardTreeTexture);
-	glUniformMatrix4fv(glGetUniformLocation(billboardTree->Program, "view"), 1, GL_FALSE, view);
-	glUniformMatrix4fv(glGetUniformLocation(billboardTree->Program, "projection"), 1, GL_FALSE, projection);
-	glBindVertexArray(billboardtree_quadVAO);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, billboardTreeTexture);
-
-	for (int x = 200; x >= -200; x -= 10) {
-		model = billBoardModel(glm::vec3(x, 20, -200), my_pos, glm::vec3(0, 1, 0));
-		model = glm::scale(model, glm::vec3(25.0f, 25.0f, 25.0f));
-		glUniformMatrix4fv(glGetUniformLocation(billboardTree->Program, "model"), 1, GL_FALSE, glm::value_ptr(model));
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-	}
-
-	glBindVertexArray(0);// setting end
-	glDisable(GL_BLEND);
-	glDepthMask(GL_TRUE);
-	
-
-	//draw billboard tree end
-	// ******************************************************************************************************************
-
-	rainSystem->update(1.0f / 30.0f);
-	//glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	rainSystem->render(view, projection, rainShader);
+	scene_graph->submit(camera, *render_queue);
+	render_queue->flush();
 
 	//projector disable
 	if (tw->projector->value()) {
-		glDisable(GL_TEXTURE_GEN_S);
-		glDisable(GL_TEXTURE_GEN_T);
-		glDisable(GL_TEXTURE_GEN_R);
-		glDisable(GL_TEXTURE_GEN_Q);
-		glDisable(GL_TEXTURE_2D);
+		GLState::disable(GL_TEXTURE_GEN_S);
+		GLState::disable(GL_TEXTURE_GEN_T);
+		GLState::disable(GL_TEXTURE_GEN_R);
+		GLState::disable(GL_TEXTURE_GEN_Q);
+		GLState::disable(GL_TEXTURE_2D);
 	}
 	
 
 	//frame buffer create different view section start
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);// now bind back to default framebuffer and draw a quad plane with the attached framebuffer color texture
-	glDisable(GL_DEPTH_TEST); // disable depth test so screen-space quad isn't discarded due to depth test.
-	// clear all relevant buffers
-	glClearColor(1.0f, 1.0f, 1.0f, 1.0f); // set clear color to white (not really necessary actually, since we won't be able to see behind the quad anyways)
-	glClear(GL_COLOR_BUFFER_BIT);
-	this->screen->Use();
-	glUniform1i(glGetUniformLocation(screen->Program, "frame_buffer_type"), tw->framebuffer->value());
-	glUniform1f(glGetUniformLocation(screen->Program, "screen_w"), w());
-	glUniform1f(glGetUniformLocation(screen->Program, "screen_h"), h());
-	glUniform1f(glGetUniformLocation(screen->Program, "t"), 0.0f * 20); // tw->time = 0.0f
-	glUniform2f(glGetUniformLocation(screen->Program, "u_texelStep"), 1.0f / w(), 1.0f / h());
-	glUniform1i(glGetUniformLocation(screen->Program, "u_showEdges"), 0);
-	glUniform1i(glGetUniformLocation(screen->Program, "u_fxaaOn"), 1);
-	glUniform1i(glGetUniformLocation(screen->Program, "u_lumaThreshold"), 0.5);
-	glUniform1i(glGetUniformLocation(screen->Program, "u_mulReduce"), 8.0f);
-	glUniform1i(glGetUniformLocation(screen->Program, "u_minReduce"), 128.0f);
-	glUniform1i(glGetUniformLocation(screen->Program, "u_maxSpan"), 8.0f);
-	glBindVertexArray(screen_quadVAO);
-	glBindTexture(GL_TEXTURE_2D, screen_textureColorbuffer);	// use the color attachment texture as the texture of the quad plane
-
-	if (tw->framebuffer->value() == 8) {
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, textureColorbuffer[0]);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, textureColorbuffer[1]);
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, textureColorbuffer[2]);
-		glActiveTexture(GL_TEXTURE3);
-		glBindTexture(GL_TEXTURE_2D, textureColorbuffer[3]);
-		glActiveTexture(GL_TEXTURE4);
-		glBindTexture(GL_TEXTURE_2D, textureColorbuffer[4]);
-		glActiveTexture(GL_TEXTURE5);
-		glBindTexture(GL_TEXTURE_2D, textureColorbuffer[5]);
-		glActiveTexture(GL_TEXTURE6);
-		glBindTexture(GL_TEXTURE_2D, textureColorbuffer[6]);
-		glActiveTexture(GL_TEXTURE7);
-		glBindTexture(GL_TEXTURE_2D, textureColorbuffer[7]);
+	glm::mat4 view_projection = glm::make_mat4(projection) * glm::make_mat4(view);
+	if (scene) {
+		// motion blur only needs where each pixel was last frame, rebuilt from depth and the two camera matrices
+		RenderTargetPool::Target* velocity = nullptr;
+		if (post_process->enabled("motion blur")) {
+			velocity = render_targets->acquire({ w(), h(), GL_RG16F, 0 });
+			GLState::bind_framebuffer(GL_FRAMEBUFFER, velocity->fbo);
+			glViewport(0, 0, w(), h());
+			GLState::disable(GL_DEPTH_TEST);
+			velocity_shader->Use();
+			velocity_shader->setInt(u_depthTexture, 0);
+			velocity_shader->setVec2(u_uv_scale, scene_uv_scale.x, scene_uv_scale.y);
+			velocity_shader->setMat4(u_reprojection, glm::value_ptr(previous_view_projection * glm::inverse(view_projection)));
+			GLState::active_texture(GL_TEXTURE0);
+			GLState::bind_texture(GL_TEXTURE_2D, scene->depth);
+			post_process->quad();
+			velocity_texture = velocity->texture;
+		}
+		post_process->run(*render_targets, scene, w(), h());
+		render_targets->release(velocity);
+		render_targets->release(scene);
 	}
-	glDrawArrays(GL_TRIANGLES, 0, 6);
-	glUseProgram(0);
+	previous_view_projection = view_projection;
+	gpu_timer->end();
+	update_render_scale();
 	//frame buffer create different view section end
 }
 
@@ -1041,7 +1021,7 @@ setProjection()
 
 	// Check whether we use the world cam
 	if (tw->worldCam->value())
-		arcball.setProjection(false);
+		camera.arcball(arcball, aspect, .1f, 1000.0f);
 	// Or we use the top cam
 	else if (tw->topCam->value()) {
 		float wi, he;
@@ -1056,11 +1036,8 @@ setProjection()
 
 		// Set up the top camera drop mode to be orthogonal and set
 		// up proper projection matrix
-		glMatrixMode(GL_PROJECTION);
-		glOrtho(-wi, wi, -he, he, 200, -200);
-		glMatrixMode(GL_MODELVIEW);
-		glLoadIdentity();
-		glRotatef(-90,1,0,0);
+		camera.projection = glm::ortho(-wi, wi, -he, he, 200.0f, -200.0f);
+		camera.set_view(glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1, 0, 0)));
 	} 
 	// Or do the train view or other view here
 	//####################################################################
@@ -1088,17 +1065,17 @@ setProjection()
 		up = up * 5.0f;
 		Pnt3f pos = qt + up;
 
-		glMatrixMode(GL_PROJECTION);
-		glLoadIdentity();
-		gluPerspective(60, aspect, 0.01, 200);
-		glMatrixMode(GL_MODELVIEW);
-		glLoadIdentity();
-		gluLookAt(pos.x, pos.y, pos.z, pos.x + forward.x, pos.y + forward.y, pos.z + forward.z, up.x, up.y, up.z);
+		camera.projection = glm::perspective(glm::radians(60.0f), aspect, 0.01f, 200.0f);
+		camera.set_view(glm::lookAt(glm::vec3(pos.x, pos.y, pos.z),
+			glm::vec3(pos.x + forward.x, pos.y + forward.y, pos.z + forward.z), glm::vec3(up.x, up.y, up.z)));
 
 #ifdef EXAMPLE_SOLUTION
 		trainCamView(this,aspect);
 #endif
 	}
+
+	// the shaders read the matrices from camera, the stacks only serve what is still drawn fixed-function
+	camera.load();
 }
 
 //************************************************************************
@@ -1468,11 +1445,11 @@ void TrainView::drawTrain(TrainView*, bool doingShadows)
 				0.0, 0.0, 0.0, 1.0
 	};
 
-	GLfloat projection[16];
-	GLfloat view_ptr[16];
-	glGetFloatv(GL_PROJECTION_MATRIX, projection);
-	glGetFloatv(GL_MODELVIEW_MATRIX, view_ptr);
-	glm::mat4 view = glm::make_mat4(view_ptr);
+	GLfloat* projection = glm::value_ptr(camera.projection);
+	glm::mat4 view = camera.view;
+	// the same squish onto the floor setupShadows puts on the stack
+	if (doingShadows)
+		view = view * glm::scale(glm::mat4(1.0f), glm::vec3(1, 0, 1));
 	view = glm::translate(view, glm::vec3(capybara_pos.x, capybara_pos.y, capybara_pos.z));
 	view = view * glm::make_mat4(rotation);
 	view = glm::rotate(view, glm::radians(90.0f), glm::vec3(1, 0, 0));
@@ -1481,8 +1458,11 @@ void TrainView::drawTrain(TrainView*, bool doingShadows)
 	glm::mat4 model = glm::mat4(1.0f);
 	model = glm::scale(model, glm::vec3(4, 4, 4));
 
-	drawModel(capybara, for_model_texture, capybara_tex, projection, glm::value_ptr(view), model);
-	glUseProgram(0);
+	// the model is about its box's diagonal across, scaled by 4
+	float capybara_radius = glm::length(capybara->high - capybara->low) * 0.5f * 4.0f;
+	capybara_lod = capybara->lod(camera.screen_size(glm::vec3(capybara_pos.x, capybara_pos.y, capybara_pos.z), capybara_radius), capybara_lod);
+	drawModel(capybara, for_model_texture, capybara_tex, projection, glm::value_ptr(view), model, capybara_lod);
+	GLState::use_program(0);
 
 	// smoke
 	if (tw->smoke->value()) {
@@ -1572,7 +1552,7 @@ void TrainView::drawWheel(Pnt3f qt, Pnt3f forward, Pnt3f cross, Pnt3f up, float
 //
 // * this tries to see which control point is under the mouse
 //	  (for when the mouse is clicked)
-//		it uses OpenGL picking - which is always a trick
+//		it casts a ray from the camera through the mouse
 //########################################################################
 // TODO: 
 //		if you want to pick things other than control points, or you
@@ -1583,52 +1563,29 @@ void TrainView::
 doPick()
 //========================================================================
 {
-	// since we'll need to do some GL stuff so we make this window as 
-	// active window
-	make_current();		
-
+	// camera still holds the matrices of the frame on screen, so no GL is needed here.
 	// where is the mouse?
-	int mx = Fl::event_x(); 
-	int my = Fl::event_y();
-
-	// get the viewport - most reliable way to turn mouse coords into GL coords
-	int viewport[4];
-	glGetIntegerv(GL_VIEWPORT, viewport);
-
-	// Set up the pick matrix on the stack - remember, FlTk is
-	// upside down!
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity ();
-	gluPickMatrix((double)mx, (double)(viewport[3]-my), 
-						5, 5, viewport);
-
-	// now set up the projection
-	setProjection();
-
-	// now draw the objects - but really only see what we hit
-	GLuint buf[100];
-	glSelectBuffer(100,buf);
-	glRenderMode(GL_SELECT);
-	glInitNames();
-	glPushName(0);
-
-	// draw the cubes, loading the names as we go
-	for(size_t i=0; i<m_pTrack->points.size(); ++i) {
-		glLoadName((GLuint) (i+1));
-		m_pTrack->points[i].draw();
+	glm::vec3 from, to;
+	camera.ray((float)Fl::event_x(), (float)Fl::event_y(), w(), h(), from, to);
+	glm::vec3 dir = glm::normalize(to - from);
+
+	// the nearest control point whose cube the ray passes through,
+	// the cubes are tested as spheres that about cover them
+	const float radius = 3.0f;
+	float nearest = FLT_MAX;
+	selectedCube = -1;
+	for (size_t i = 0; i < m_pTrack->points.size(); ++i) {
+		const Pnt3f& p = m_pTrack->points[i].pos;
+		glm::vec3 offset = glm::vec3(p.x, p.y, p.z) - from;
+		float along = glm::dot(offset, dir);
+		if (along < 0 || glm::length(offset - dir * along) > radius)
+			continue;
+		if (along < nearest) {
+			nearest = along;
+			selectedCube = (int)i;
+		}
 	}
 
-	// go back to drawing mode, and see how picking did
-	int hits = glRenderMode(GL_RENDER);
-	if (hits) {
-		// warning; this just grabs the first object hit - if there
-		// are multiple objects, you really want to pick the closest
-		// one - see the OpenGL manual 
-		// remember: we load names that are one more than the index
-		selectedCube = buf[3]-1;
-	} else // nothing hit, nothing selected
-		selectedCube = -1;
-
 	printf("Selected Cube %d\n",selectedCube);
 }
 //========================================================================
@@ -235,8 +235,8 @@ TrainWindow(const int x, const int y)
 		pty += 30;
 
 		framebuffer = new Fl_Browser(605,pty,190,165,"Frame Buffer Type");
-		framebuffer->type(2);		// select
-		framebuffer->callback((Fl_Callback*)damageCB, this);
+		framebuffer->type(FL_MULTI_BROWSER);	// effects stack, see postProcessCB
+		framebuffer->callback((Fl_Callback*)postProcessCB, this);
 		framebuffer->add("default");
 		framebuffer->add("pixel");
 		framebuffer->add("offset");
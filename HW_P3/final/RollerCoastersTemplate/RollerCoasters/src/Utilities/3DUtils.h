@@ -51,6 +51,7 @@ void drawCube(float x, float y, float z, float l);
 //       the actual colors are two global variables 
 extern float floorColor1[3];
 extern float floorColor2[3];
+extern float floorColor3[3];	// the grass green drawFloor uses
 
 //************************************************************************
 // draw the actual ground plane
@@ -0,0 +1,300 @@
+#ifndef VEGETATION_H
+#define VEGETATION_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "model.h"
+#include "Camera.h"
+#include "Impostor.h"
+#include "RenderUtilities/GLState.h"
+#include "Utilities/3DUtils.H"
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <future>
+#include <random>
+#include <cfloat>
+#include <iostream>
+
+// props scattered over the floor from a density map, drawn with indirect instanced draws.
+// the instances are sorted into square cells once, and every frame only the cells are tested against the frustum,
+// so the cpu cost follows the number of cells and not the number of props.
+// close cells draw the layer's mesh and far ones its impostor. every visible cell becomes one indirect command
+// whose baseInstance points at the cell's range of the layer's instance buffer
+class Vegetation
+{
+public:
+    struct Cell
+    {
+        GLuint first, count;        // range of the layer's instances
+        float min_y, max_y;         // of the ground under them
+    };
+
+    struct Layer
+    {
+        std::string name;
+        Model* mesh;
+        Shader* shader;
+        // sets the mesh shader's own uniforms and textures
+        std::function<void(Shader*)> bind;
+        int channel;                // of the density map, 0 red, 1 green, 2 blue
+        int per_cell;               // candidates per cell, the density map decides how many of them stay
+        glm::vec2 scale;            // random size range
+        float mesh_distance;        // cells closer than this draw the mesh
+        float max_distance;         // cells further than this are dropped
+        Impostor* impostor;         // for the far cells, nullptr drops them at mesh_distance instead
+
+        // filled by add() and scatter()
+        glm::vec2 bounds = glm::vec2(0.0f);   // width and height of the mesh at scale 1
+        std::vector<Instance> instances = {};
+        std::vector<Cell> cells = {};
+        InstanceBuffer buffer = {};
+    };
+
+    float size = 500.0f;            // the floor square, centered on the origin
+    int cells_per_side = 20;
+
+    // last frame's numbers
+    int cells_drawn = 0;
+    int cells_culled = 0;
+    int instances_drawn = 0;
+
+    Vegetation() {}
+    Vegetation(const Vegetation&) = delete;
+    Vegetation& operator=(const Vegetation&) = delete;
+    ~Vegetation()
+    {
+        for (Layer* layer : layers) {
+            if (layer->buffer.buffer)
+                glDeleteBuffers(1, &layer->buffer.buffer);
+            delete layer;
+        }
+        if (indirect)
+            glDeleteBuffers(1, &indirect);
+        GLState::invalidate();
+    }
+
+    // layers are drawn in the order they were added
+    Layer* add(const std::string& name, Model* mesh, Shader* shader, std::function<void(Shader*)> bind, int channel, int per_cell,
+        glm::vec2 scale, float mesh_distance, float max_distance, Impostor* impostor = nullptr)
+    {
+        Layer* layer = new Layer{ name, mesh, shader, bind, channel, per_cell, scale, mesh_distance, max_distance, impostor };
+        // from the ground up, whatever the mesh's own box starts at
+        glm::vec3 low = glm::min(mesh->low, glm::vec3(0.0f)), high = glm::max(mesh->high, glm::vec3(0.0f));
+        layer->bounds = glm::vec2((std::max)(high.x - low.x, high.z - low.z), high.y);
+        layers.push_back(layer);
+        return layer;
+    }
+
+    // places every layer's instances. the density map is stretched over the floor, a missing one counts as full everywhere.
+    // the rows of cells are filled in parallel, each cell from its own generator so the result doesn't depend on the threads
+    void scatter(const std::string& density_path)
+    {
+        int w = 0, h = 0, n = 0;
+        unsigned char* density = stbi_load(density_path.c_str(), &w, &h, &n, 3);
+        if (!density)
+            std::cout << "ERROR::VEGETATION::DENSITY_MAP_NOT_LOADED " << density_path << std::endl;
+
+        for (size_t l = 0; l < layers.size(); l++) {
+            Layer* layer = layers[l];
+            std::vector<std::future<Row>> rows;
+            for (int row = 0; row < cells_per_side; row++)
+                rows.push_back(std::async(std::launch::async, [this, layer, l, row, density, w, h]() {
+                    return scatter_row(*layer, l, row, density, w, h);
+                }));
+
+            layer->instances.clear();
+            layer->cells.clear();
+            for (auto& future : rows) {
+                Row row = future.get();
+                GLuint first = (GLuint)layer->instances.size();
+                for (GLuint count : row.counts) {
+                    layer->cells.push_back(Cell{ first, count, 0.0f, 0.0f });
+                    first += count;
+                }
+                layer->instances.insert(layer->instances.end(), row.instances.begin(), row.instances.end());
+            }
+        }
+        if (density)
+            stbi_image_free(density);
+        // put them on the floor on the next draw
+        lifted_noise = -1.0f;
+    }
+
+    // draws what the camera sees with impostor_shader for the far cells. noise is the floor's,
+    // the props are moved onto it again when it changes
+    void draw(const Camera& camera, float noise, Shader* impostor_shader)
+    {
+        if (noise != lifted_noise)
+            lift(noise);
+
+        glm::vec4 planes[6];
+        camera.frustum(planes);
+        float cell_size = size / cells_per_side;
+        cells_drawn = cells_culled = instances_drawn = 0;
+
+        // the commands of every batch share one buffer, a batch is a range of it drawn with a single call
+        std::vector<DrawElementsIndirectCommand> commands;
+        std::vector<Batch> batches;
+        std::vector<const Cell*> near_cells, far_cells;
+        for (Layer* layer : layers) {
+            near_cells.clear();
+            far_cells.clear();
+            // props stick out of their cell by up to half their width
+            float margin = 0.5f * layer->bounds.x * layer->scale.y;
+            for (size_t i = 0; i < layer->cells.size(); i++) {
+                const Cell& cell = layer->cells[i];
+                if (!cell.count)
+                    continue;
+                glm::vec2 corner = glm::vec2(i % cells_per_side, i / cells_per_side) * cell_size - size * 0.5f;
+                glm::vec3 low(corner.x - margin, cell.min_y, corner.y - margin);
+                glm::vec3 high(corner.x + cell_size + margin, cell.max_y + layer->bounds.y * layer->scale.y, corner.y + cell_size + margin);
+                float distance = glm::length(glm::clamp(camera.position, low, high) - camera.position);
+                bool distant = distance >= layer->mesh_distance;
+                if (distance > layer->max_distance || (distant && !layer->impostor) || !Camera::visible(planes, low, high)) {
+                    cells_culled++;
+                    continue;
+                }
+                (distant ? far_cells : near_cells).push_back(&cell);
+                cells_drawn++;
+                instances_drawn += cell.count;
+            }
+            for (size_t m = 0; !near_cells.empty() && m < layer->mesh->meshes.size(); m++) {
+                batches.push_back(Batch{ layer, (int)m, commands.size(), near_cells.size() });
+                GLuint count = (GLuint)layer->mesh->meshes[m].indices.size();
+                for (const Cell* cell : near_cells)
+                    commands.push_back(DrawElementsIndirectCommand{ count, cell->count, 0, 0, cell->first });
+            }
+            if (!far_cells.empty()) {
+                batches.push_back(Batch{ layer, -1, commands.size(), far_cells.size() });
+                for (const Cell* cell : far_cells)
+                    commands.push_back(DrawElementsIndirectCommand{ 6, cell->count, 0, 0, cell->first });
+            }
+        }
+        if (commands.empty())
+            return;
+
+        if (!indirect)
+            glGenBuffers(1, &indirect);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirect);
+        // respecified every frame so the driver can hand out new memory instead of waiting on last frame's draws
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STREAM_DRAW);
+        Layer* bound = nullptr;
+        for (Batch& batch : batches) {
+            GLintptr offset = batch.first * sizeof(DrawElementsIndirectCommand);
+            if (batch.mesh >= 0) {
+                if (bound != batch.layer) {
+                    batch.layer->shader->Use();
+                    if (batch.layer->bind)
+                        batch.layer->bind(batch.layer->shader);
+                    bound = batch.layer;
+                }
+                batch.layer->mesh->meshes[batch.mesh].DrawIndirect(*batch.layer->shader, batch.layer->buffer, offset, (GLsizei)batch.count);
+            }
+            else {
+                draw_impostors(*batch.layer, impostor_shader, camera, offset, (GLsizei)batch.count);
+                bound = nullptr;
+            }
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        GLState::use_program(0);
+    }
+
+private:
+    struct Row
+    {
+        std::vector<Instance> instances;
+        std::vector<GLuint> counts;     // per cell, left to right
+    };
+
+    struct Batch
+    {
+        Layer* layer;
+        int mesh;                       // -1 for the impostors
+        size_t first, count;            // commands
+    };
+
+    Row scatter_row(const Layer& layer, size_t l, int row, const unsigned char* density, int w, int h) const
+    {
+        Row result;
+        float cell_size = size / cells_per_side;
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        for (int column = 0; column < cells_per_side; column++) {
+            std::minstd_rand random((unsigned)(((l * cells_per_side + row) * cells_per_side + column) * 7919 + 1));
+            glm::vec2 corner = glm::vec2(column, row) * cell_size - size * 0.5f;
+            GLuint count = 0;
+            for (int i = 0; i < layer.per_cell; i++) {
+                glm::vec2 p = corner + glm::vec2(unit(random), unit(random)) * cell_size;
+                float keep = unit(random);
+                if (density) {
+                    int x = (std::min)(w - 1, (int)((p.x / size + 0.5f) * w));
+                    int y = (std::min)(h - 1, (int)((p.y / size + 0.5f) * h));
+                    if (keep * 255.0f >= density[(y * w + x) * 3 + layer.channel])
+                        continue;
+                }
+                Instance instance;
+                instance.Transform = glm::translate(glm::mat4(1.0f), glm::vec3(p.x, 0.0f, p.y));
+                instance.Transform = glm::rotate(instance.Transform, unit(random) * 6.2831853f, glm::vec3(0, 1, 0));
+                instance.Transform = glm::scale(instance.Transform, glm::vec3(glm::mix(layer.scale.x, layer.scale.y, unit(random))));
+                instance.Dissolve = 0.5f + 0.5f * unit(random);
+                instance.Phase = unit(random) * 6.2831853f;
+                result.instances.push_back(instance);
+                count++;
+            }
+            result.counts.push_back(count);
+        }
+        return result;
+    }
+
+    // stands every instance on the floor and refreshes the cells' height ranges, a row of cells per thread
+    void lift(float noise)
+    {
+        // perlinNoise shuffles its table with rand() the first time, that has to happen here and not on a worker
+        getFloorHeight(0.0f, 0.0f, noise);
+        for (Layer* layer : layers) {
+            std::vector<std::future<void>> rows;
+            for (int row = 0; row < cells_per_side; row++)
+                rows.push_back(std::async(std::launch::async, [layer, row, noise, this]() {
+                    for (int c = row * cells_per_side; c < (row + 1) * cells_per_side; c++) {
+                        Cell& cell = layer->cells[c];
+                        cell.min_y = FLT_MAX;
+                        cell.max_y = -FLT_MAX;
+                        for (GLuint i = cell.first; i < cell.first + cell.count; i++) {
+                            glm::mat4& transform = layer->instances[i].Transform;
+                            transform[3].y = getFloorHeight(transform[3].x, transform[3].z, noise);
+                            cell.min_y = (std::min)(cell.min_y, transform[3].y);
+                            cell.max_y = (std::max)(cell.max_y, transform[3].y);
+                        }
+                    }
+                }));
+            for (auto& row : rows)
+                row.get();
+            layer->buffer.upload(layer->instances);
+        }
+        lifted_noise = noise;
+    }
+
+    // two triangles per prop, the impostor's quad with the cells' instances attached
+    void draw_impostors(Layer& layer, Shader* shader, const Camera& camera, GLintptr offset, GLsizei count)
+    {
+        static const Shader::Handle u_projection = Shader::handle("projection");
+        static const Shader::Handle u_view = Shader::handle("view");
+        static const Shader::Handle u_cameraPos = Shader::handle("cameraPos");
+
+        shader->Use();
+        shader->setMat4(u_projection, glm::value_ptr(camera.projection));
+        shader->setMat4(u_view, glm::value_ptr(camera.view));
+        shader->setVec3(u_cameraPos, camera.position.x, camera.position.y, camera.position.z);
+        layer.impostor->bind(shader);
+        layer.buffer.bind();
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)offset, count, 0);
+    }
+
+    std::vector<Layer*> layers;
+    float lifted_noise = -1.0f;
+    GLuint indirect = 0;
+};
+#endif
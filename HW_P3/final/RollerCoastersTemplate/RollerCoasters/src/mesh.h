@@ -7,9 +7,11 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "RenderUtilities/Shader.h"
+#include "RenderUtilities/GLState.h"
 
 #include <string>
 #include <vector>
+#include <algorithm>
 using namespace std;
 
 struct Vertex {
@@ -25,6 +27,74 @@ struct Vertex {
     glm::vec3 Bitangent;
 };
 
+// per-instance data for Mesh::DrawInstanced, read by the vertex shader from locations 5 to 9
+struct Instance {
+    // transform, one column per location from 5 to 8
+    glm::mat4 Transform;
+    // location 9, how far a dissolving prop is gone and where it is in its animation
+    float Dissolve = 0.0f;
+    float Phase = 0.0f;
+};
+
+// the binding the instance buffer is attached to, far above the ones the vertex attributes use
+#define INSTANCE_BINDING 15
+
+// describes the Instance attributes to the bound VAO, they advance once per instance
+inline void setupInstanceAttributes()
+{
+    for (int i = 0; i < 4; i++)
+    {
+        glEnableVertexAttribArray(5 + i);
+        glVertexAttribFormat(5 + i, 4, GL_FLOAT, GL_FALSE, offsetof(Instance, Transform) + i * sizeof(glm::vec4));
+        glVertexAttribBinding(5 + i, INSTANCE_BINDING);
+    }
+    glEnableVertexAttribArray(9);
+    glVertexAttribFormat(9, 2, GL_FLOAT, GL_FALSE, offsetof(Instance, Dissolve));
+    glVertexAttribBinding(9, INSTANCE_BINDING);
+    glVertexBindingDivisor(INSTANCE_BINDING, 1);
+}
+
+// a vertex buffer of Instances that grows when it has to, upload once for static props or every frame for moving ones
+class InstanceBuffer {
+public:
+    GLuint buffer = 0;
+    GLsizei count = 0;
+
+    void upload(const vector<Instance>& instances)
+    {
+        if (!buffer)
+            glGenBuffers(1, &buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        GLsizeiptr size = instances.size() * sizeof(Instance);
+        if (size > capacity) {
+            glBufferData(GL_ARRAY_BUFFER, size, instances.data(), GL_DYNAMIC_DRAW);
+            capacity = size;
+        }
+        else if (size > 0)
+            glBufferSubData(GL_ARRAY_BUFFER, 0, size, instances.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        count = (GLsizei)instances.size();
+    }
+
+    // attaches the buffer to the bound VAO, which setupInstanceAttributes has described
+    void bind() const
+    {
+        glBindVertexBuffer(INSTANCE_BINDING, buffer, 0, sizeof(Instance));
+    }
+
+private:
+    GLsizeiptr capacity = 0;
+};
+
+// the layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand {
+    GLuint count;           // indices per instance
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint  baseVertex;
+    GLuint baseInstance;    // first Instance the command reads
+};
+
 struct Texture {
     unsigned int id;
     string type;
@@ -38,6 +108,10 @@ public:
     vector<unsigned int> indices;
     vector<Texture>      textures;
     unsigned int VAO;
+    // box around the vertices, for culling
+    glm::vec3 low = glm::vec3(0.0f), high = glm::vec3(0.0f);
+    // the simplified versions of indices over the same vertices, coarser with every level. level 0 is indices itself
+    vector<vector<unsigned int>> lods;
 
     // constructor
     Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
@@ -45,6 +119,13 @@ public:
         this->vertices = vertices;
         this->indices = indices;
         this->textures = textures;
+        if (!vertices.empty()) {
+            low = high = vertices[0].Position;
+            for (const Vertex& v : vertices) {
+                low = glm::min(low, v.Position);
+                high = glm::max(high, v.Position);
+            }
+        }
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
         setupMesh();
@@ -52,16 +133,132 @@ public:
 
     // render the mesh
     void Draw(Shader& shader)
+    {
+        Draw(shader, 0);
+    }
+
+    // render the mesh at a level of detail, past the coarsest one draws the coarsest
+    void Draw(Shader& shader, int level)
+    {
+        bindTextures(shader);
+
+        // draw mesh
+        // left bound, the next draw of the same mesh doesn't have to bind it again
+        GLState::bind_vertex_array(VAO);
+        glDrawElements(GL_TRIANGLES, count(level), GL_UNSIGNED_INT, (void*)(first(level) * sizeof(unsigned int)));
+
+        // always good practice to set everything back to defaults once configured.
+        GLState::active_texture(GL_TEXTURE0);
+    }
+
+    // puts the levels after indices in the index buffer, every level is a range of the same buffer
+    void setLods(const vector<vector<unsigned int>>& levels)
+    {
+        lods = levels;
+        vector<unsigned int> all = indices;
+        for (const vector<unsigned int>& level : lods)
+            all.insert(all.end(), level.begin(), level.end());
+        GLState::bind_vertex_array(VAO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, all.size() * sizeof(unsigned int), all.data(), GL_STATIC_DRAW);
+    }
+
+    int levels() const { return 1 + (int)lods.size(); }
+
+    // where a level starts in the index buffer and how many indices it has
+    GLuint first(int level) const
+    {
+        level = (std::min)((std::max)(level, 0), levels() - 1);
+        size_t first = 0;
+        for (int i = 0; i < level; i++)
+            first += i == 0 ? indices.size() : lods[i - 1].size();
+        return (GLuint)first;
+    }
+    GLsizei count(int level) const
+    {
+        level = (std::min)((std::max)(level, 0), levels() - 1);
+        return (GLsizei)(level == 0 ? indices.size() : lods[level - 1].size());
+    }
+
+    // render the mesh count times in one call, the shader tells the copies apart with gl_InstanceID
+    void DrawInstanced(Shader& shader, GLsizei count)
+    {
+        bindTextures(shader);
+
+        GLState::bind_vertex_array(VAO);
+        glDrawElementsInstanced(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0, count);
+
+        GLState::active_texture(GL_TEXTURE0);
+    }
+
+    // render the mesh once per Instance in instances, the shader reads them from locations 5 to 9
+    void DrawInstanced(Shader& shader, const InstanceBuffer& instances)
+    {
+        if (!instances.count)
+            return;
+        bindTextures(shader);
+
+        bindInstances(instances);
+        glDrawElementsInstanced(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0, instances.count);
+
+        GLState::active_texture(GL_TEXTURE0);
+    }
+
+    // drawcount commands from the bound GL_DRAW_INDIRECT_BUFFER starting at offset, in one call.
+    // each command takes its instances from instances starting at its baseInstance
+    void DrawIndirect(Shader& shader, const InstanceBuffer& instances, GLintptr offset, GLsizei drawcount)
+    {
+        if (!drawcount)
+            return;
+        bindTextures(shader);
+
+        bindInstances(instances);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)offset, drawcount, 0);
+
+        GLState::active_texture(GL_TEXTURE0);
+    }
+
+private:
+    // render data 
+    unsigned int VBO, EBO;
+    bool instanced = false;
+
+    // sampler handle per texture, named like texture_diffuseN where N counts up per type
+    vector<Shader::Handle> samplers;
+
+    // binds the VAO with instances attached
+    void bindInstances(const InstanceBuffer& instances)
+    {
+        GLState::bind_vertex_array(VAO);
+        // described on first use, an enabled attribute without a buffer would be undefined for plain draws
+        if (!instanced) {
+            setupInstanceAttributes();
+            instanced = true;
+        }
+        instances.bind();
+    }
+
+    void bindTextures(Shader& shader)
     {
         // bind appropriate textures
+        for (unsigned int i = 0; i < textures.size(); i++)
+        {
+            GLState::active_texture(GL_TEXTURE0 + i); // active proper texture unit before binding
+            // now set the sampler to the correct texture unit
+            shader.setInt(samplers[i], i);
+            // and finally bind the texture
+            GLState::bind_texture(GL_TEXTURE_2D, textures[i].id);
+        }
+    }
+
+    // initializes all the buffer objects/arrays
+    void setupMesh()
+    {
         unsigned int diffuseNr = 1;
         unsigned int specularNr = 1;
         unsigned int normalNr = 1;
         unsigned int heightNr = 1;
-
         for (unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
             // retrieve texture number (the N in diffuse_textureN)
             string number;
             string name = textures[i].type;
@@ -73,35 +270,15 @@ public:
                 number = std::to_string(normalNr++); // transfer unsigned int to stream
             else if (name == "texture_height")
                 number = std::to_string(heightNr++); // transfer unsigned int to stream
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.Program, (name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            samplers.push_back(Shader::handle(name + number));
         }
 
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
-    }
-
-private:
-    // render data 
-    unsigned int VBO, EBO;
-
-    // initializes all the buffer objects/arrays
-    void setupMesh()
-    {
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &EBO);
 
-        glBindVertexArray(VAO);
+        GLState::bind_vertex_array(VAO);
         // load data into vertex buffers
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
         // A great thing about structs is that their memory layout is sequential for all its items.
@@ -129,7 +306,7 @@ private:
         glEnableVertexAttribArray(4);
         glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
 
-        glBindVertexArray(0);
+        GLState::bind_vertex_array(0);
     }
 };
 #endif
\ No newline at end of file
@@ -11,6 +11,7 @@
 #include "assimp/postprocess.h"
 #include "stb_image.h"
 #include "mesh.h"
+#include "QuadricSimplifier.h"
 #include "RenderUtilities/Shader.h"
 
 #include <string>
@@ -19,6 +20,12 @@
 #include <iostream>
 #include <map>
 #include <vector>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <future>
+#include <random>
+#include <filesystem>
 using namespace std;
 
 unsigned int TextureFromFile(const char* path, const string& directory, bool gamma = false);
@@ -34,26 +41,45 @@ public:
     int height_map_index = 0;
     string directory;
     bool gammaCorrection;
+    // box around every mesh, low is above high when nothing was loaded
+    glm::vec3 low = glm::vec3(FLT_MAX), high = glm::vec3(-FLT_MAX);
+
+    // every level of detail keeps about this much of the triangles of the one before
+    static constexpr float LOD_RATIO = 0.35f;
+    // level 1 starts when the model covers less than this much of the screen height, every further level at half the size of the one before
+    static constexpr float LOD_SCREEN_SIZE = 0.25f;
+    // how far past a threshold the size has to go before the level changes back, so a model sitting on one doesn't flicker
+    static constexpr float LOD_HYSTERESIS = 0.15f;
+
     // constructor, expects a filepath to a 3D model.
-    Model(string const& path, bool gamma = false) : gammaCorrection(gamma)
+    // lod_levels simplified versions of every mesh are made after loading, or read back from the cache when the file hasn't changed
+    Model(string const& path, bool gamma = false, int lod_levels = 0) : gammaCorrection(gamma)
     {
-        loadModel(path);
+        loadModel(path, lod_levels);
+    }
+
+    // where the simplified meshes are kept between runs, empty turns the cache off
+    static std::string& lodCacheDirectory()
+    {
+        static std::string directory = "./lod_cache/";
+        return directory;
     }
 
     // draws the model, and thus all its meshes
     void Draw_wave(Shader& shader,int wave_type)
     {
+        static const Shader::Handle u_height_map_texture = Shader::handle("height_map_texture");
         if(wave_type == 2){
             for (unsigned int i = 0; i < height_map_meshes.size(); i++) {
                 for (auto& j : height_map_meshes[i].textures) {
                     j.id = height_map_id[height_map_index];
                 }
-                glActiveTexture(GL_TEXTURE0 + i);
-                glUniform1i(glGetUniformLocation(shader.Program, "height_map_texture"), height_map_id[height_map_index]);
-                glBindTexture(GL_TEXTURE_2D, height_map_id[height_map_index]);
+                GLState::active_texture(GL_TEXTURE0 + i);
+                shader.setInt(u_height_map_texture, height_map_id[height_map_index]);
+                GLState::bind_texture(GL_TEXTURE_2D, height_map_id[height_map_index]);
                 height_map_meshes[i].Draw(shader);
             }
-            glActiveTexture(GL_TEXTURE0);
+            GLState::active_texture(GL_TEXTURE0);
         }
         else {
             for (unsigned int i = 0; i < meshes.size(); i++)
@@ -65,12 +91,48 @@ public:
         for (unsigned int i = 0; i < meshes.size(); i++)
             meshes[i].Draw(shader);
     }
+    // every mesh at a level of detail from lod()
+    void Draw(Shader& shader, int level)
+    {
+        for (unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].Draw(shader, level);
+    }
+    // levels of detail including the full one
+    int levels() const { return meshes.empty() ? 1 : meshes[0].levels(); }
+    // the level for a model covering screen_size of the screen height (Camera::screen_size), previous is the level it had last frame
+    int lod(float screen_size, int previous) const
+    {
+        int level = (std::min)((std::max)(previous, 0), levels() - 1);
+        while (level + 1 < levels() && screen_size < threshold(level + 1) * (1.0f - LOD_HYSTERESIS))
+            level++;
+        while (level > 0 && screen_size > threshold(level) * (1.0f + LOD_HYSTERESIS))
+            level--;
+        return level;
+    }
+    // every mesh count times, one draw call per mesh
+    void DrawInstanced(Shader& shader, GLsizei count)
+    {
+        for (unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].DrawInstanced(shader, count);
+    }
+    // every mesh once per Instance in the buffer, one draw call per mesh however many instances there are
+    void DrawInstanced(Shader& shader, const InstanceBuffer& instances)
+    {
+        for (unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].DrawInstanced(shader, instances);
+    }
     void add_height_map_texture(const char* _path, const string& _directory) {
         height_map_id.push_back(TextureFromFile(_path, _directory));
     }
 private:
+    // the screen size below which level starts
+    static float threshold(int level)
+    {
+        return LOD_SCREEN_SIZE * std::pow(0.5f, (float)(level - 1));
+    }
+
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const& path)
+    void loadModel(string const& path, int lod_levels)
     {
         // read file via ASSIMP
         Assimp::Importer importer;
@@ -85,6 +147,144 @@ private:
         directory = path.substr(0, path.find_last_of('/'));
         // process ASSIMP's root node recursively
         processNode(scene->mRootNode, scene);
+        for (const Mesh& mesh : meshes) {
+            low = glm::min(low, mesh.low);
+            high = glm::max(high, mesh.high);
+        }
+        if (lod_levels > 0)
+            makeLods(path, lod_levels);
+    }
+
+    // the simplified meshes, from the cache or made in parallel, one task per mesh
+    void makeLods(string const& path, int lod_levels)
+    {
+        vector<vector<vector<unsigned int>>> lods;
+        string cache = lodCachePath(path);
+        if (!loadLods(cache, path, lod_levels, lods)) {
+            vector<future<vector<vector<unsigned int>>>> tasks;
+            for (const Mesh& mesh : meshes)
+                tasks.push_back(std::async(std::launch::async, [&mesh, lod_levels]() {
+                    // each level is made from the one before, the errors of the collapses so far stay in it
+                    vector<vector<unsigned int>> levels;
+                    const vector<unsigned int>* previous = &mesh.indices;
+                    for (int i = 0; i < lod_levels; i++) {
+                        levels.push_back(QuadricSimplifier::simplify(mesh.vertices, *previous, (size_t)(previous->size() / 3 * LOD_RATIO)));
+                        previous = &levels.back();
+                    }
+                    return levels;
+                }));
+            for (auto& task : tasks)
+                lods.push_back(task.get());
+            saveLods(cache, path, lod_levels, lods);
+        }
+        // the buffers are uploaded here, the tasks can't touch the context
+        for (unsigned int i = 0; i < meshes.size(); i++) {
+            meshes[i].setLods(lods[i]);
+            height_map_meshes[i].lods = lods[i];
+        }
+    }
+
+    // the layout of a cache file: a header, then per mesh its vertex and index count and the indices of every level
+    static constexpr uint32_t LOD_MAGIC = 0x32444f4c;  // "LOD2", bumped whenever the simplifier makes different levels
+    struct LodHeader
+    {
+        uint32_t magic;
+        uint32_t levels;
+        float ratio;
+        uint32_t meshes;
+        uint64_t source_size;
+        int64_t source_time;
+    };
+
+    static string lodCachePath(string const& path)
+    {
+        if (lodCacheDirectory().empty())
+            return "";
+        return lodCacheDirectory() + std::filesystem::path(path).filename().string() + ".lod";
+    }
+
+    // the header this model would be cached with, changing the file or the settings invalidates the cache
+    LodHeader lodHeader(string const& path, int lod_levels) const
+    {
+        LodHeader header = { LOD_MAGIC, (uint32_t)lod_levels, LOD_RATIO, (uint32_t)meshes.size(), 0, 0 };
+        std::error_code error;
+        header.source_size = (uint64_t)std::filesystem::file_size(path, error);
+        header.source_time = (int64_t)std::filesystem::last_write_time(path, error).time_since_epoch().count();
+        return header;
+    }
+
+    bool loadLods(string const& cache, string const& path, int lod_levels, vector<vector<vector<unsigned int>>>& lods) const
+    {
+        if (cache.empty())
+            return false;
+        ifstream file(cache, std::ios::binary);
+        if (!file)
+            return false;
+        LodHeader expected = lodHeader(path, lod_levels), header;
+        if (!file.read((char*)&header, sizeof(header)) || std::memcmp(&header, &expected, sizeof(header)) != 0)
+            return false;
+        // read into a copy, lods is only touched when the whole file checks out
+        vector<vector<vector<unsigned int>>> loaded(meshes.size(), vector<vector<unsigned int>>(lod_levels));
+        for (unsigned int i = 0; i < meshes.size(); i++) {
+            uint32_t counts[2];
+            if (!file.read((char*)counts, sizeof(counts)) || counts[0] != meshes[i].vertices.size() || counts[1] != meshes[i].indices.size())
+                return false;
+            for (vector<unsigned int>& level : loaded[i]) {
+                uint32_t count;
+                if (!file.read((char*)&count, sizeof(count)) || count > meshes[i].indices.size())
+                    return false;
+                level.resize(count);
+                if (!file.read((char*)level.data(), count * sizeof(unsigned int)))
+                    return false;
+                for (unsigned int index : level)
+                    if (index >= meshes[i].vertices.size())
+                        return false;
+            }
+        }
+        lods.swap(loaded);
+        return true;
+    }
+
+    void saveLods(string const& cache, string const& path, int lod_levels, const vector<vector<vector<unsigned int>>>& lods) const
+    {
+        if (cache.empty())
+            return;
+        std::error_code error;
+        std::filesystem::create_directories(lodCacheDirectory(), error);
+        // written next to the cache and renamed over it, so a crash never leaves half a file behind.
+        // the temporary name is random, two instances building the same model each publish a whole file of their own
+        std::random_device random;
+        string temporary = cache + "." + std::to_string(random()) + std::to_string(random()) + ".tmp";
+        ofstream file(temporary, std::ios::binary);
+        if (!file)
+        {
+            cout << "ERROR::MODEL::LOD_CACHE::WRITE_FAILED\n" << cache << endl;
+            return;
+        }
+        LodHeader header = lodHeader(path, lod_levels);
+        file.write((const char*)&header, sizeof(header));
+        for (unsigned int i = 0; i < meshes.size(); i++) {
+            uint32_t counts[2] = { (uint32_t)meshes[i].vertices.size(), (uint32_t)meshes[i].indices.size() };
+            file.write((const char*)counts, sizeof(counts));
+            for (const vector<unsigned int>& level : lods[i]) {
+                uint32_t count = (uint32_t)level.size();
+                file.write((const char*)&count, sizeof(count));
+                file.write((const char*)level.data(), count * sizeof(unsigned int));
+            }
+        }
+        file.close();
+        if (!file)
+        {
+            cout << "ERROR::MODEL::LOD_CACHE::WRITE_FAILED\n" << cache << endl;
+            std::filesystem::remove(temporary, error);
+            return;
+        }
+        std::filesystem::rename(temporary, cache, error);
+        if (error)
+        {
+            cout << "ERROR::MODEL::LOD_CACHE::WRITE_FAILED\n" << cache << endl;
+            std::filesystem::remove(temporary, error);
+        }
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
@@ -246,7 +446,7 @@ unsigned int TextureFromFile(const char* path, const string& directory, bool gam
         else if (nrComponents == 4)
             format = GL_RGBA;
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
+        GLState::bind_texture(GL_TEXTURE_2D, textureID);
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
 